@@ -0,0 +1,181 @@
+#ifndef ADAPTIVE_QUALITY_H
+#define ADAPTIVE_QUALITY_H
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "log_ring.h"
+
+// 측정한 전송 속도에 맞춰 해상도와 JPEG 품질을 조절하는 제어기.
+// 스트림 전송 태스크들이 프레임마다 전송 시간과 크기를 넘겨주고 (adapt_observe),
+// 캡처 태스크가 윈도우마다 목표 FPS 를 유지할 수 있는지 판단해서 센서를 바꾼다 (adapt_tick).
+// 단계 (level) 는 (해상도, 품질) 조합을 좋은 것부터 나쁜 것 순서로 나열한 것이다.
+// 해상도는 adapt_sizes 의 4:3 크기만 쓴다. framesize_t 를 하나씩 내리면 240X240, HQVGA, QCIF 처럼
+// 가로세로 비가 다른 크기를 거쳐서 PC 쪽 모델 입력과 ROI 가 틀어진다.
+// 판단 로직 (adapt_step) 은 센서와 무관하므로 호스트에서 대역폭 기록으로 시험할 수 있다.
+
+#define ADAPTIVE_QUALITY 1
+
+typedef struct {
+    float target_fps;        // 유지하려는 FPS
+    float hysteresis;        // 목표 대비 여유 (0.2 = +-20%)
+    int down_windows;        // 연속 몇 윈도우 동안 느리면 한 단계 내릴지
+    int up_windows;          // 연속 몇 윈도우 동안 여유가 있으면 한 단계 올릴지
+    int64_t window_us;       // 판단 주기
+    uint32_t min_frames;     // 윈도우 안에 이 수보다 적게 보냈으면 판단하지 않음
+    int quality_best;        // jpeg_quality 범위 (숫자가 작을수록 고품질)
+    int quality_worst;
+    int quality_step;
+    framesize_t size_max;    // 해상도 범위 (adapt_sizes 안). 최대값은 esp_camera_init 의 frame_size 보다 클 수 없다
+    framesize_t size_min;
+} adapt_config_t;
+
+typedef struct {
+    int level;               // 0 = 최고 해상도/품질
+    int levels;              // 단계 수
+    int below;               // 연속으로 느렸던 윈도우 수
+    int above;               // 연속으로 여유 있었던 윈도우 수
+    int hold;                // 변경 직후 건너뛸 윈도우 수 (이전 설정의 프레임이 빠져나갈 때까지)
+    float est_fps;           // 마지막으로 추정한 전송 가능 FPS
+    uint32_t changes;
+} adapt_state_t;
+
+static adapt_config_t adapt_config = {
+    15.0f, 0.2f, 2, 4, 1000000LL, 3,
+    10, 30, 5,
+    FRAMESIZE_QVGA, FRAMESIZE_QQVGA,
+};
+static adapt_state_t adapt_state;
+
+// 전송 태스크들이 쓰는 현재 윈도우 누적값 (원자적으로 더한다)
+static uint32_t adapt_frames = 0;
+static uint32_t adapt_send_us = 0;
+static uint32_t adapt_bytes = 0;
+static int64_t adapt_window_start = 0;
+
+// 단계에 쓰는 4:3 해상도 (큰 것부터)
+static const framesize_t adapt_sizes[] = {
+    FRAMESIZE_UXGA, FRAMESIZE_XGA, FRAMESIZE_SVGA, FRAMESIZE_VGA, FRAMESIZE_QVGA, FRAMESIZE_QQVGA,
+};
+#define ADAPT_SIZE_COUNT (int)(sizeof(adapt_sizes) / sizeof(adapt_sizes[0]))
+
+// size 보다 크지 않은 첫 4:3 해상도의 번호
+static int adapt_size_index(framesize_t size) {
+    for (int i = 0; i < ADAPT_SIZE_COUNT; i++) {
+        if (adapt_sizes[i] <= size) {
+            return i;
+        }
+    }
+    return ADAPT_SIZE_COUNT - 1;
+}
+
+static int adapt_quality_steps(const adapt_config_t *cfg) {
+    return (cfg->quality_worst - cfg->quality_best) / cfg->quality_step + 1;
+}
+
+framesize_t adapt_level_framesize(const adapt_config_t *cfg, int level) {
+    return adapt_sizes[adapt_size_index(cfg->size_max) + level / adapt_quality_steps(cfg)];
+}
+
+int adapt_level_quality(const adapt_config_t *cfg, int level) {
+    return cfg->quality_best + (level % adapt_quality_steps(cfg)) * cfg->quality_step;
+}
+
+void adapt_state_init(const adapt_config_t *cfg, adapt_state_t *st, int level) {
+    memset(st, 0, sizeof(adapt_state_t));
+    st->levels = adapt_quality_steps(cfg) * (adapt_size_index(cfg->size_min) - adapt_size_index(cfg->size_max) + 1);
+    st->level = constrain(level, 0, st->levels - 1);
+}
+
+// 윈도우 하나의 측정값으로 단계를 정한다. 단계가 바뀌면 true.
+// est_fps: 링크가 보낼 수 있는 FPS 추정치 (1 초 / 프레임당 평균 전송 시간)
+bool adapt_step(const adapt_config_t *cfg, adapt_state_t *st, float est_fps) {
+    st->est_fps = est_fps;
+    if (st->hold > 0) {
+        st->hold--;
+        return false;
+    }
+
+    if (est_fps < cfg->target_fps * (1.0f - cfg->hysteresis)) {
+        st->below++;
+        st->above = 0;
+    } else if (est_fps > cfg->target_fps * (1.0f + cfg->hysteresis)) {
+        st->above++;
+        st->below = 0;
+    } else {
+        // 목표 근처에서는 유지
+        st->below = 0;
+        st->above = 0;
+    }
+
+    int level = st->level;
+    if (st->below >= cfg->down_windows && level < st->levels - 1) {
+        level++;
+    } else if (st->above >= cfg->up_windows && level > 0) {
+        level--;
+    }
+    if (level == st->level) {
+        return false;
+    }
+    st->level = level;
+    st->below = 0;
+    st->above = 0;
+    st->hold = 1;
+    st->changes++;
+    return true;
+}
+
+// esp_camera_init 에 쓴 설정에 맞춰 시작 단계를 정한다
+void adapt_init(framesize_t framesize, int quality) {
+    adapt_config.size_max = adapt_sizes[min(adapt_size_index(framesize), adapt_size_index(adapt_config.size_min))];
+    int q = constrain(quality, adapt_config.quality_best, adapt_config.quality_worst);
+    adapt_state_init(&adapt_config, &adapt_state,
+                     (q - adapt_config.quality_best) / adapt_config.quality_step);
+}
+
+// 스트림 전송 태스크에서 프레임을 보낼 때마다 호출
+void adapt_observe(uint32_t send_us, uint32_t bytes) {
+    __atomic_add_fetch(&adapt_frames, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&adapt_send_us, send_us, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&adapt_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+// 캡처 태스크에서 프레임마다 호출. 윈도우가 끝나면 판단하고 센서를 바꾼다.
+void adapt_tick() {
+#if ADAPTIVE_QUALITY
+    int64_t now = esp_timer_get_time();
+    if (adapt_window_start == 0) {
+        adapt_window_start = now;
+        return;
+    }
+    if (now - adapt_window_start < adapt_config.window_us) {
+        return;
+    }
+    adapt_window_start = now;
+
+    uint32_t frames = __atomic_exchange_n(&adapt_frames, 0, __ATOMIC_RELAXED);
+    uint32_t send_us = __atomic_exchange_n(&adapt_send_us, 0, __ATOMIC_RELAXED);
+    uint32_t bytes = __atomic_exchange_n(&adapt_bytes, 0, __ATOMIC_RELAXED);
+    if (frames < adapt_config.min_frames || send_us == 0) {
+        return;
+    }
+
+    float est_fps = frames * 1000000.0f / send_us;
+    if (adapt_step(&adapt_config, &adapt_state, est_fps)) {
+        sensor_t *s = esp_camera_sensor_get();
+        framesize_t size = adapt_level_framesize(&adapt_config, adapt_state.level);
+        int quality = adapt_level_quality(&adapt_config, adapt_state.level);
+        if (s) {
+            if (s->status.framesize != size) {
+                s->set_framesize(s, size);
+            }
+            s->set_quality(s, quality);
+        }
+        int fps10 = (int)(est_fps * 10);  // 로그 링에는 float 를 넣을 수 없다
+        LOG_I("adaptive: est %d.%d fps, %u bytes/frame -> level %d (framesize %d, quality %d)",
+              fps10 / 10, fps10 % 10, (unsigned)(bytes / frames), adapt_state.level, (int)size, quality);
+    }
+#endif
+}
+
+#endif  // ADAPTIVE_QUALITY_H
@@ -17,6 +17,17 @@ int trim = 0;
 #include "SetMotor.h"
 #include "jsonContwsPC.h"
 #include "jsonContwsHP.h"
+#include "frame_share.h"
+#include "stream_stats.h"
+#include "adaptive_quality.h"
+#include "task_topology.h"
+#include "log_ring.h"
+#include "still_frame.h"
+#include "blackbox.h"
+#include "ctrl_dispatch.h"
+#include "motor_task.h"
+#include "stream_sender.h"
+#include "video_ws.h"
 
 
 // 전역 변수 선언
@@ -26,34 +37,33 @@ TaskHandle_t capture_task_handle = NULL;
 volatile bool capture_task_running = false;
 
 
-camera_fb_t *shared_fb = NULL;
-SemaphoreHandle_t xSemaphore = NULL;  // 동기화를 위한 세마포어
-
-static esp_err_t send_frame(httpd_req_t *req); // 프로토타입 선언
 void capture_frame(void* param);
 
 extern esp_err_t ws_handler(httpd_req_t *req);
 
 
-
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
-
 httpd_handle_t stream_httpd = NULL;
 httpd_handle_t alt_stream_httpd = NULL;
 
 httpd_handle_t ws_httpd = NULL;
 httpd_handle_t alt_ws_httpd = NULL;
 
+// 1 이면 /stream, /alt_stream, /ws, /alt_ws 를 포트 81 서버 하나에서 처리한다.
+// 서버마다 태스크, 스택, 소켓 테이블을 따로 가지므로 내부 RAM 을 크게 줄일 수 있다.
+// 스트림은 전송 태스크 (stream_sender.h) 가 보내므로 서버 태스크를 붙잡지 않는다.
+#ifndef CAMERA_SINGLE_SERVER
+#define CAMERA_SINGLE_SERVER 1
+#endif
+// 단일 서버 모드에서도 예전 포트 (82, 91, 92) 를 호환용으로 열어둘지.
+// 예전 클라이언트가 바로 끊기지 않도록 기본은 연다. 서버가 셋 더 생겨 단일 서버로 아낀 RAM 을
+// 대부분 되돌리므로, 클라이언트가 모두 81 번으로 옮겨가면 0 으로 빌드한다.
+#ifndef CAMERA_LEGACY_PORTS
+#define CAMERA_LEGACY_PORTS 1
+#endif
 
-// stream_handler 수정
-static esp_err_t stream_handler(httpd_req_t *req) {
-    esp_err_t res = ESP_OK;
-
-    Serial.printf("start stream_handler %d\n", client_count);
 
+// 스트림 세션이 시작될 때 호출. 첫 번째 클라이언트면 캡처 태스크를 시작한다.
+void capture_client_join() {
     // 클라이언트 수 증가
     if (xSemaphoreTake(client_count_semaphore, portMAX_DELAY)) {
         client_count++;
@@ -61,19 +71,16 @@ static esp_err_t stream_handler(httpd_req_t *req) {
             // 첫 번째 클라이언트가 연결되었으므로 캡처 태스크 시작
             if (capture_task_handle == NULL) {
                 capture_task_running = true;  // 플래그를 true로 설정
-                xTaskCreate(capture_frame, "capture_frame", 4096, NULL, 1, &capture_task_handle);
+                task_create(capture_frame, "capture_frame", 4096, NULL,
+                            TASK_PRIO_CAPTURE, TASK_CORE_CAPTURE, &capture_task_handle);
             }
         }
         xSemaphoreGive(client_count_semaphore);
     }
+}
 
-    httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
-    while (true) {
-        if (send_frame(req) != ESP_OK) {
-            break;
-        }
-    }
-
+// 스트림 세션이 끝날 때 호출. 마지막 클라이언트면 캡처 태스크를 멈춘다.
+void capture_client_leave() {
     // 클라이언트 수 감소
     if (xSemaphoreTake(client_count_semaphore, portMAX_DELAY)) {
         client_count--;
@@ -92,151 +99,432 @@ static esp_err_t stream_handler(httpd_req_t *req) {
             xSemaphoreGive(client_count_semaphore);  // 세마포어 해제
         }
     }
+}
 
-    Serial.printf("end stream_handler %d\n", client_count);
-
-    return ESP_OK;
+// 캡처 태스크와 스트림 세션의 성능 카운터를 JSON 으로 보낸다
+// task_report 의 콜백. 태스크 하나씩 JSON 배열 원소로 보낸다.
+typedef struct {
+    httpd_req_t *req;
+    bool first;
+} stats_task_arg_t;
+
+static void stats_task_json(void *arg, const char *json, int len) {
+    stats_task_arg_t *a = (stats_task_arg_t *)arg;
+    if (!a->first) {
+        httpd_resp_send_chunk(a->req, ",", 1);
+    }
+    httpd_resp_send_chunk(a->req, json, len);
+    a->first = false;
 }
 
+static esp_err_t stats_handler(httpd_req_t *req) {
+    char buf[256];
+    int n;
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    n = snprintf(buf, sizeof(buf), "{\"uptime_ms\":%u,\"free_heap\":%u,\"clients\":%d,"
+                 "\"capture\":{\"frames\":%u,\"failed\":%u,\"wait_us\":",
+                 (unsigned)(esp_timer_get_time() / 1000), (unsigned)esp_get_free_heap_size(), client_count,
+                 (unsigned)capture_stats.frames, (unsigned)capture_stats.failed);
+    n = stats_json_fit(n, sizeof(buf));
+    n += stats_summary_json(buf + n, sizeof(buf) - n, &capture_stats.wait_us);
+    httpd_resp_send_chunk(req, buf, n);
+    n = snprintf(buf, sizeof(buf), ",\"interval_us\":");
+    n = stats_json_fit(n, sizeof(buf));
+    n += stats_summary_json(buf + n, sizeof(buf) - n, &capture_stats.interval_us);
+    httpd_resp_send_chunk(req, buf, n);
+    n = snprintf(buf, sizeof(buf), ",\"still\":%u},\"adaptive\":{\"level\":%d,\"est_fps\":%.1f,\"changes\":%u},\"evictions\":%u,\"pools\":",
+                  (unsigned)still_state.still, adapt_state.level, adapt_state.est_fps,
+                  (unsigned)adapt_state.changes, (unsigned)stream_evictions);
+    n = stats_json_fit(n, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    n = block_pool_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    httpd_resp_send_chunk(req, ",\"blackbox\":", 12);
+    n = blackbox_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    httpd_resp_send_chunk(req, ",\"ctrl\":", 8);
+    n = ctrl_stats_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    httpd_resp_send_chunk(req, ",\"ws_rx\":", 9);
+    n = ws_rx_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    n = snprintf(buf, sizeof(buf), ",\"cmds\":{\"count\":%d,\"unknown\":%u,\"probe_max\":%d,\"list\":[",
+                 cmd_count, (unsigned)cmd_unknown, cmd_probe_max);
+    n = stats_json_fit(n, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    for (int i = 0; (n = cmd_entry_json(i, buf, sizeof(buf))) > 0; i++) {
+        httpd_resp_send_chunk(req, buf, n);
+    }
+    httpd_resp_send_chunk(req, "]}", 2);
+    httpd_resp_send_chunk(req, ",\"motor\":", 9);
+    n = motor_stats_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    httpd_resp_send_chunk(req, ",\"telemetry\":", 13);
+    n = telemetry_stats_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    httpd_resp_send_chunk(req, ",\"log\":", 7);
+    n = log_stats_json(buf, sizeof(buf));
+    httpd_resp_send_chunk(req, buf, n);
+    httpd_resp_send_chunk(req, ",\"streams\":[", 12);
+
+    bool first = true;
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        stream_ctx_t *ctx = &stream_clients[i];
+        const char *name = ctx->name;
+        if (!name) {
+            continue;
+        }
+        stats_summary_t send;
+        stats_hist_summary(&ctx->send_us, &send);
+        n = snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"sent\":%u,\"dropped\":%u,"
+                     "\"fps\":%.1f,\"bytes_per_s\":%u,\"wire_bytes\":%llu,\"send_calls\":%u,\"send_us\":",
+                     first ? "" : ",", name, (unsigned)ctx->sent, (unsigned)ctx->dropped,
+                     send.rate, (unsigned)send.amount_rate, (unsigned long long)ctx->wire_bytes,
+                     (unsigned)ctx->send_calls);
+        n = stats_json_fit(n, sizeof(buf));
+        n += stats_summary_json(buf + n, sizeof(buf) - n, &ctx->send_us);
+        httpd_resp_send_chunk(req, buf, n);
+        n = snprintf(buf, sizeof(buf), ",\"suppressed\":%u,\"saved_bytes\":%llu",
+                     (unsigned)ctx->suppressed, (unsigned long long)ctx->saved_bytes);
+        n = stats_json_fit(n, sizeof(buf));
+        httpd_resp_send_chunk(req, buf, n);
+        n = snprintf(buf, sizeof(buf), ",\"stalls\":%u,\"backpressure\":%u,\"demote\":%d,\"late\":%u,\"latency_us\":",
+                     (unsigned)ctx->stalls, (unsigned)ctx->backpressure, ctx->demote, (unsigned)ctx->late);
+        n = stats_json_fit(n, sizeof(buf));
+        n += stats_summary_json(buf + n, sizeof(buf) - n, &ctx->latency_us);
+        httpd_resp_send_chunk(req, buf, n);
+        n = 0;
+        if (ctx->tensor) {
+            int m = snprintf(buf + n, sizeof(buf) - n, ",\"tensor\":[%d,%d,%d],\"prep_us\":",
+                             ctx->tensor->h, ctx->tensor->w, ctx->tensor->c);
+            n += stats_json_fit(m, sizeof(buf) - n);
+            n += stats_summary_json(buf + n, sizeof(buf) - n, &ctx->prep_us);
+        }
+        if (ctx->roi_rgb) {
+            roi_rect_t roi = roi_unpack(ctx->roi_cur);
+            int m = snprintf(buf + n, sizeof(buf) - n, ",\"roi\":[%d,%d,%d,%d],\"prep_us\":", roi.x, roi.y, roi.w, roi.h);
+            n += stats_json_fit(m, sizeof(buf) - n);
+            n += stats_summary_json(buf + n, sizeof(buf) - n, &ctx->prep_us);
+        }
+        if (ctx->kind == STREAM_UDP) {
+            int m = snprintf(buf + n, sizeof(buf) - n, ",\"udp_partial\":%u", (unsigned)ctx->udp_partial);
+            n += stats_json_fit(m, sizeof(buf) - n);
+        }
+        n += stats_json_fit(snprintf(buf + n, sizeof(buf) - n, "}"), sizeof(buf) - n);
+        httpd_resp_send_chunk(req, buf, n);
+        first = false;
+    }
 
-// stream_handler 수정
-static esp_err_t alt_stream_handler(httpd_req_t *req) {
-    esp_err_t res = ESP_OK;
+    httpd_resp_send_chunk(req, "],\"tasks\":[", 11);
+    stats_task_arg_t task_arg = { req, true };
+    task_report(stats_task_json, &task_arg);
+    httpd_resp_send_chunk(req, "]}", 2);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
 
-    Serial.printf("start alt_stream_handler %d\n", client_count);
+// stream_handler 수정
+static esp_err_t stream_handler(httpd_req_t *req) {
+    return stream_session_start(req, "stream_handler");
+}
 
-    // 클라이언트 수 증가
-    if (xSemaphoreTake(client_count_semaphore, portMAX_DELAY)) {
-        client_count++;
-        if (client_count > 0) {
-            // 첫 번째 클라이언트가 연결되었으므로 캡처 태스크 시작
-            if (capture_task_handle == NULL) {
-                capture_task_running = true;  // 플래그를 true로 설정
-                xTaskCreate(capture_frame, "capture_frame", 4096, NULL, 1, &capture_task_handle);
+// PC 용 스트림. ?format=gray 또는 ?format=rgb 이면 JPEG 대신 축소한 텐서를 보낸다
+// (&size=96 처럼 크기 지정, 기본 96x96).
+static esp_err_t alt_stream_handler(httpd_req_t *req) {
+    char query[64];
+    char value[16];
+    int tensor_size = 0;
+    int tensor_channels = 1;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+            if (strcmp(value, "gray") == 0) {
+                tensor_size = 96;
+                tensor_channels = 1;
+            } else if (strcmp(value, "rgb") == 0) {
+                tensor_size = 96;
+                tensor_channels = 3;
             }
         }
-        xSemaphoreGive(client_count_semaphore);
+        if (tensor_size && httpd_query_key_value(query, "size", value, sizeof(value)) == ESP_OK) {
+            tensor_size = constrain(atoi(value), 8, TENSOR_MAX_SIZE);
+        }
     }
+    return stream_session_start(req, "alt_stream_handler", STREAM_MULTIPART, tensor_size, tensor_channels);
+}
 
-    httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
-    while (true) {
-        if (send_frame(req) != ESP_OK) {
-            break;
+// 캡처 태스크가 없을 때 사진 한 장만 찍는다. 카메라 드라이버에 오래 전에 채워진
+// 버퍼가 남아 있을 수 있으므로 요청 이후에 찍힌 프레임이 나올 때까지 버린다.
+static camera_fb_t *snapshot_grab() {
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i <= camera_fb_count; i++) {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (!fb) {
+            return NULL;
+        }
+        int64_t captured = (int64_t)fb->timestamp.tv_sec * 1000000LL + fb->timestamp.tv_usec;
+        if (captured >= start || i == camera_fb_count) {
+            return fb;
         }
+        esp_camera_fb_return(fb);
     }
+    return NULL;
+}
 
-    // 클라이언트 수 감소
-    if (xSemaphoreTake(client_count_semaphore, portMAX_DELAY)) {
-        client_count--;
-        if (client_count == 0) {
-            // 마지막 클라이언트가 연결을 해제했으므로 캡처 태스크 중지
-            if (capture_task_handle != NULL) {
-                capture_task_running = false;  // 플래그를 false로 설정
-                xSemaphoreGive(client_count_semaphore);  // 세마포어 해제
-                // 태스크가 종료될 시간을 주기 위해 지연
-                vTaskDelay(pdMS_TO_TICKS(100));
-                capture_task_handle = NULL;
-            } else {
-                xSemaphoreGive(client_count_semaphore);  // 세마포어 해제
-            }
-        } else {
-            xSemaphoreGive(client_count_semaphore);  // 세마포어 해제
-        }
+// 가장 최근에 게시된 프레임 한 장. 캡처 태스크가 돌고 있으면 새로 찍지 않고
+// 공유 프레임을 복사 없이 그대로 보낸다. ETag 는 프레임 번호이므로 그 사이
+// 새 프레임이 없으면 If-None-Match 에 304 로 답한다.
+// 부팅마다 프레임 번호가 1 부터 다시 시작하므로 ETag 앞에 부팅 번호를 붙인다.
+static uint32_t snapshot_boot_id = 0;
+
+// 보내는 동안 잡고 있는 프레임과 미리 만든 응답 헤더. 전송 태스크가 보내고 놓는다.
+typedef struct {
+    frame_ref_t *frame;    // 공유 프레임 (캡처 중일 때)
+    camera_fb_t *single;   // 직접 찍은 한 장 (캡처 중이 아닐 때)
+    int hdr_len;
+    char hdr[320];
+} snapshot_job_arg_t;
+
+static void snapshot_job_free(snapshot_job_arg_t *job) {
+    if (job->single) {
+        esp_camera_fb_return(job->single);
+    } else {
+        frame_release(job->frame);
     }
+    block_free(job);
+}
 
-    Serial.printf("end alt_stream_handler %d\n", client_count);
-    return ESP_OK;
+static esp_err_t snapshot_job(stream_ctx_t *ctx, void *arg) {
+    snapshot_job_arg_t *job = (snapshot_job_arg_t *)arg;
+    const camera_fb_t *fb = job->single ? job->single : job->frame->fb;
+    // 카메라 버퍼에서 바로 보낸다. 보내는 동안 참조를 잡고 있으므로 버퍼는 반환되지 않는다.
+    esp_err_t res = stream_job_write(ctx, job->hdr, job->hdr_len);
+    if (res == ESP_OK) {
+        res = stream_job_write(ctx, fb->buf, fb->len);
+    }
+    snapshot_job_free(job);
+    return res;
 }
 
-static esp_err_t send_frame(httpd_req_t *req) {
-    esp_err_t res = ESP_OK;
-    size_t _jpg_buf_len = 0;
-    uint8_t *_jpg_buf = NULL;
-    char part_buf[64];
-
-    // Take the semaphore to access shared_fb
-    if (xSemaphoreTake(xSemaphore, portMAX_DELAY)) {
-        if (shared_fb) {
-            _jpg_buf_len = shared_fb->len;
-            // Allocate memory for the frame copy
-            _jpg_buf = (uint8_t *)malloc(_jpg_buf_len);
-            if (_jpg_buf) {
-                memcpy(_jpg_buf, shared_fb->buf, _jpg_buf_len);
+static esp_err_t snapshot_handler(httpd_req_t *req) {
+    snapshot_job_arg_t *job = (snapshot_job_arg_t *)block_alloc(sizeof(snapshot_job_arg_t));
+    if (!job) {
+        return httpd_resp_send_500(req);
+    }
+    job->single = NULL;
+    job->frame = frame_acquire();
+    if (!job->frame) {
+        // 캡처 중이 아니다. 그 사이 캡처 태스크가 시작되지 않도록 잡고 한 장 찍는다.
+        if (xSemaphoreTake(client_count_semaphore, portMAX_DELAY)) {
+            if (capture_task_handle == NULL) {
+                job->single = snapshot_grab();
             } else {
-                Serial.println("Failed to allocate memory for frame copy");
-                res = ESP_ERR_NO_MEM;
+                job->frame = frame_acquire();  // 캡처 태스크가 막 시작되었다
             }
-        } else {
-            // 프레임이 없는 경우 약간의 지연 후 다시 시도
-            xSemaphoreGive(xSemaphore);
-            vTaskDelay(pdMS_TO_TICKS(10));
-            return ESP_OK;
+            xSemaphoreGive(client_count_semaphore);
+        }
+        if (!job->single && !job->frame) {
+            LOG_E("Snapshot capture failed");
+            block_free(job);
+            return httpd_resp_send_500(req);
         }
-        // Release the semaphore
-        xSemaphoreGive(xSemaphore);
-    } else {
-        Serial.println("Failed to take semaphore");
-        res = ESP_FAIL;
     }
 
-    if (res == ESP_OK && _jpg_buf) {
-        // Send the frame to the client
-        size_t hlen = snprintf(part_buf, sizeof(part_buf), _STREAM_PART, _jpg_buf_len);
-        res = httpd_resp_send_chunk(req, part_buf, hlen);
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
+    char etag[24] = "";
+    char tags[80] = "";
+    if (job->frame) {
+        char inm[32];
+        snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)snapshot_boot_id, (unsigned)job->frame->seq);
+        if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) == ESP_OK &&
+            strcmp(inm, etag) == 0) {
+            snapshot_job_free(job);
+            httpd_resp_set_hdr(req, "ETag", etag);
+            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            httpd_resp_set_status(req, "304 Not Modified");
+            return httpd_resp_send(req, NULL, 0);
         }
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
-        }
-        // Free the copied frame buffer
-        free(_jpg_buf);
+        snprintf(tags, sizeof(tags), "ETag: %s\r\nX-Frame-Seq: %u\r\n", etag, (unsigned)job->frame->seq);
     }
 
+    const camera_fb_t *fb = job->single ? job->single : job->frame->fb;
+    job->hdr_len = snprintf(job->hdr, sizeof(job->hdr),
+                            "HTTP/1.1 200 OK\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n"
+                            "Access-Control-Allow-Origin: *\r\n"
+                            "Cache-Control: no-cache\r\n"  // 매번 ETag 로 다시 확인하도록
+                            "%sX-Timestamp: %d.%06d\r\nConnection: close\r\n\r\n",
+                            (unsigned)fb->len, tags, (int)fb->timestamp.tv_sec, (int)fb->timestamp.tv_usec);
+
+    // 본문은 전송 태스크가 보낸다. 스트림이 전송 태스크를 모두 쓰고 있으면 잠시 뒤 다시 받게 한다.
+    if (!stream_job_start(req, "snapshot", snapshot_job, job)) {
+        snapshot_job_free(job);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        return httpd_resp_send(req, "No free stream sender", HTTPD_RESP_USE_STRLEN);
+    }
+    return ESP_OK;
+}
+
+// /blackbox : 링을 얼리고 색인과 기록을 한 파일로 보낸다. ?clear=1 이면 보낸 뒤 비운다.
+// 1.5 MB 까지 보내므로 제어 명령을 처리하는 httpd 태스크가 아니라 전송 태스크가 보낸다.
+typedef struct {
+    size_t len;           // 파일 크기
+    bool clear;
+} blackbox_job_arg_t;
+
+static esp_err_t blackbox_job_write(void *arg, const void *data, size_t len) {
+    return stream_job_write((stream_ctx_t *)arg, data, len);
+}
+
+static esp_err_t blackbox_job(stream_ctx_t *ctx, void *arg) {
+    blackbox_job_arg_t *job = (blackbox_job_arg_t *)arg;
+    char hdr[256];
+    int n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+                     "Content-Disposition: attachment; filename=\"blackbox.bin\"\r\n"
+                     "Content-Length: %u\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                     (unsigned)job->len);
+    esp_err_t res = stream_job_write(ctx, hdr, n);
+    if (res == ESP_OK) {
+        res = blackbox_write_archive(blackbox_job_write, ctx);
+    }
+    blackbox_thaw(res == ESP_OK && job->clear);
+    block_free(job);
     return res;
 }
 
+static esp_err_t blackbox_handler(httpd_req_t *req) {
+    if (!blackbox.ring) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Blackbox disabled");
+        return ESP_FAIL;
+    }
+    char query[32];
+    char value[8];
+    bool clear = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                 httpd_query_key_value(query, "clear", value, sizeof(value)) == ESP_OK && atoi(value) != 0;
+
+    blackbox_job_arg_t *job = (blackbox_job_arg_t *)block_alloc(sizeof(blackbox_job_arg_t));
+    if (!job) {
+        return httpd_resp_send_500(req);
+    }
+    job->clear = clear;
+    if (!blackbox_freeze(&job->len)) {
+        block_free(job);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, "Blackbox download in progress", HTTPD_RESP_USE_STRLEN);
+    }
+    if (!stream_job_start(req, "blackbox", blackbox_job, job)) {
+        blackbox_thaw(false);
+        block_free(job);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, "No free stream sender", HTTPD_RESP_USE_STRLEN);
+    }
+    return ESP_OK;  // 응답은 전송 태스크가 보낸다
+}
+
 void capture_frame(void* param) {
+    still_reset();
+    // esp_camera_fb_get() 은 새 프레임이 준비될 때까지 블록되므로 센서 속도로 돈다
     while (capture_task_running) {
-        if (xSemaphoreTake(xSemaphore, portMAX_DELAY)) {
-            if (shared_fb) {
-                esp_camera_fb_return(shared_fb);  // 이전 프레임 반환
+        if (camera_fb_count == 1) {
+            // 버퍼가 하나뿐이면 게시 중인 프레임을 먼저 내려놓아야 새 프레임을 받을 수 있다
+            frame_publish(NULL);
+        }
+        int64_t wait_start = esp_timer_get_time();
+        camera_fb_t *fb = esp_camera_fb_get();  // 새로운 프레임 가져오기
+        int64_t now = esp_timer_get_time();
+        int64_t work_start = now;
+        if (!fb) {
+            capture_stats.failed++;
+            LOG_E("Failed to capture frame");
+            vTaskDelay(pdMS_TO_TICKS(10));
+        } else {
+            //Serial.printf("Captured frame: %u bytes\n", fb->len);
+            capture_stats.frames++;
+            stats_hist_add(&capture_stats.wait_us, now - wait_start, fb->len);
+            if (capture_stats.last_us != 0) {
+                stats_hist_add(&capture_stats.interval_us, now - capture_stats.last_us, fb->len);
             }
-            shared_fb = esp_camera_fb_get();  // 새로운 프레임 가져오기
-            if (!shared_fb) {
-                Serial.println("Failed to capture frame");
-            } else {
-                //Serial.printf("Captured frame: %u bytes\n", shared_fb->len);
+            capture_stats.last_us = now;
+            adapt_tick();  // 해상도/품질 조절은 캡처 태스크에서만 한다
+            // 차가 서 있을 때만 정지 화면을 거른다 (움직이는 동안은 모든 프레임을 보낸다)
+            bool still = STILL_SUPPRESS && car_speed == 0 && still_detect(fb);
+            // 구독자를 깨우고, 이전 프레임은 마지막 참조가 끝날 때 반환된다
+            uint32_t seq = frame_publish(fb, still);
+            if (seq) {
+                // 게시 참조가 다음 게시까지 남아 있으므로 fb 를 그대로 읽는다. 버린 프레임은 기록하지 않는다.
+                blackbox_frame(fb, seq, (int64_t)fb->timestamp.tv_sec * 1000000LL + fb->timestamp.tv_usec);
             }
-            xSemaphoreGive(xSemaphore);
+            task_busy_add(esp_timer_get_time() - work_start);  // 드라이버에서 기다린 시간은 빼고
         }
-        vTaskDelay(pdMS_TO_TICKS(10));  // 필요한 경우 지연 조정
     }
 
     // 태스크 종료 전 정리 작업
-    if (xSemaphoreTake(xSemaphore, portMAX_DELAY)) {
-        if (shared_fb) {
-            esp_camera_fb_return(shared_fb);
-            shared_fb = NULL;
-        }
-        xSemaphoreGive(xSemaphore);
-    }
+    frame_publish(NULL);
+    capture_stats.last_us = 0;
 
-    Serial.println("Capture task stopping");
+    LOG_W("Capture task stopping");
+    task_forget();
     vTaskDelete(NULL);  // 태스크 종료
 }
 
 
 // Finally, if all is well with the camera, encoding, and all else, here it is, the actual camera server.
 // If it works, use your new camera robot to grab a beer from the fridge using function Request.Fridge("beer","buschlite")
+
+// 서버 하나를 포트에 띄우고 URI 핸들러들을 등록한다
+static httpd_handle_t start_server(uint16_t port, const httpd_uri_t *uris, int uri_count) {
+  httpd_handle_t server = NULL;
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+
+  config.server_port = port;
+  config.ctrl_port = 1000 + port;  // 서버마다 제어 포트가 달라야 한다
+  config.max_uri_handlers = uri_count > 8 ? uri_count : 8;
+  config.close_fn = stream_close_fn;  // 스트림 세션의 소켓이 닫히는 것을 알기 위해
+  // 제어 명령 (모터) 이 영상 작업보다 먼저 처리되도록 (task_topology.h)
+  config.core_id = TASK_CORE_CONTROL;
+  config.task_priority = TASK_PRIO_CONTROL;
+
+  Serial.printf("Starting stream server on port: '%d'\n", config.server_port);
+  if (httpd_start(&server, &config) != ESP_OK) {
+    Serial.printf("Failed to start server on port %d\n", port);
+    return NULL;
+  }
+  for (int i = 0; i < uri_count; i++) {
+    if (httpd_register_uri_handler(server, &uris[i]) == ESP_OK) {
+      Serial.printf("  %s registered\n", uris[i].uri);
+    } else {
+      Serial.printf("  Failed to register %s\n", uris[i].uri);
+    }
+  }
+  return server;
+}
+
 void startCameraServer() {
 
   // 클라이언트 수 세마포어 초기화
   client_count_semaphore = xSemaphoreCreateMutex();
-  // 세마포어 초기화
-  xSemaphore = xSemaphoreCreateMutex();
-
-  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  // 비동기 로그 (제어/스트림 경로의 Serial 출력을 로그 태스크로 넘긴다)
+  log_task_init();
+  snapshot_boot_id = esp_random();
+  // 프레임 공유 초기화
+  frame_share_init();
+  // 고정 블록 풀 (WebSocket 메시지, 텐서 버퍼)
+  block_pool_init();
+  // 블랙박스 링 (PSRAM)
+  blackbox_init();
+  // 제어 메시지 통계 (JSON / 바이너리)
+  ctrl_stats_init();
+  // 모터 태스크 (제어 명령 우편함을 MOTOR_RATE_HZ 로 I2C 에 반영)
+  motor_task_init();
+  // 텔레메트리 태스크 (/alt_ws 의 telemetry 구독자에게 상태를 보낸다)
+  telemetry_init();
+  // /ws, /alt_ws 명령 표
+  cmd_table_init();
+  hp_register_commands();
+  pc_register_commands();
+  // 스트림 전송 태스크 시작
+  stream_sender_init();
 
   httpd_uri_t stream_uri = {
     .uri = "/stream",
@@ -252,6 +540,36 @@ void startCameraServer() {
         .user_ctx = NULL
     };
 
+  httpd_uri_t stats_uri = {
+        .uri = "/stats",
+        .method = HTTP_GET,
+        .handler = stats_handler,
+        .user_ctx = NULL
+    };
+
+  httpd_uri_t snapshot_uri = {
+        .uri = "/snapshot",
+        .method = HTTP_GET,
+        .handler = snapshot_handler,
+        .user_ctx = NULL
+    };
+
+  httpd_uri_t blackbox_uri = {
+        .uri = "/blackbox",
+        .method = HTTP_GET,
+        .handler = blackbox_handler,
+        .user_ctx = NULL
+    };
+
+  httpd_uri_t video_ws_uri = {
+        .uri = "/video_ws",
+        .method = HTTP_GET,
+        .handler = video_ws_handler,
+        .user_ctx = NULL,
+        .is_websocket = true,
+        .handle_ws_control_frames = true  // PING 에는 전송 태스크가 답한다 (video_ws.h)
+    };
+
   httpd_uri_t ws_uri = {
         .uri = "/ws",
         .method = HTTP_GET,
@@ -268,47 +586,37 @@ void startCameraServer() {
         .is_websocket = true
     };  
 
+  // 서버 시작 전후의 내부 RAM 과 태스크 수를 비교한다
+  size_t heap_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  UBaseType_t tasks_before = uxTaskGetNumberOfTasks();
+
+#if CAMERA_SINGLE_SERVER
+  // 포트 81 하나에서 모든 URI 를 처리한다
+  httpd_uri_t all_uris[] = { stream_uri, alt_stream_uri, ws_uri, alt_ws_uri, stats_uri, video_ws_uri, snapshot_uri,
+                              blackbox_uri };
+  stream_httpd = start_server(81, all_uris, sizeof(all_uris) / sizeof(all_uris[0]));
+
+#if CAMERA_LEGACY_PORTS
+  // 예전 클라이언트를 위해 기존 포트도 열어둔다
+  alt_stream_httpd = start_server(82, &alt_stream_uri, 1);
+  ws_httpd = start_server(91, &ws_uri, 1);
+  alt_ws_httpd = start_server(92, &alt_ws_uri, 1);
+#endif
 
-  config.server_port =81;
-  config.ctrl_port =1081;
-  Serial.printf("Starting stream server on port: '%d'\n", config.server_port);
-  if (httpd_start(&stream_httpd, &config) == ESP_OK) {
-    httpd_register_uri_handler(stream_httpd, &stream_uri);
-  }
-
-  config.server_port =82;
-  config.ctrl_port += 1082;
-  Serial.printf("Starting stream server on port: '%d'\n", config.server_port);
-  if (httpd_start(&alt_stream_httpd, &config) == ESP_OK) {
-    httpd_register_uri_handler(alt_stream_httpd, &alt_stream_uri);  // 추가된 핸들러
-  }
+#else
+  httpd_uri_t main_uris[] = { stream_uri, stats_uri, video_ws_uri, snapshot_uri, blackbox_uri };
+  stream_httpd = start_server(81, main_uris, sizeof(main_uris) / sizeof(main_uris[0]));
+  alt_stream_httpd = start_server(82, &alt_stream_uri, 1);  // 추가된 핸들러
 
   // move control port
+  ws_httpd = start_server(91, &ws_uri, 1);
+  alt_ws_httpd = start_server(92, &alt_ws_uri, 1);
+#endif
 
-  config.server_port = 91;  // 포트 90번 설정
-  config.ctrl_port = 1091;
-  Serial.printf("Starting stream server on port: '%d'\n", config.server_port);
-  if (httpd_start(&ws_httpd, &config) == ESP_OK) {
-      // WebSocket 핸들러 등록
-      if (httpd_register_uri_handler(ws_httpd, &ws_uri) == ESP_OK) {
-          Serial.println("WebSocket server started on /ws");
-      } else {
-          Serial.println("Failed to register WebSocket handler");
-      }
-  }
-
-  config.server_port = 92;  // 포트 91번 설정
-  config.ctrl_port = 1092;
-  Serial.printf("Starting stream server on port: '%d'\n", config.server_port);
-  if (httpd_start(&alt_ws_httpd, &config) == ESP_OK) {
-      // WebSocket 핸들러 등록
-      if (httpd_register_uri_handler(alt_ws_httpd, &alt_ws_uri) == ESP_OK) {
-          Serial.println("WebSocket server started on /alt_ws");
-      } else {
-          Serial.println("Failed to register WebSocket handler");
-      }
-  }
-
+  Serial.printf("Servers use %d bytes of internal RAM and %d tasks (free %d bytes)\n",
+                (int)(heap_before - heap_caps_get_free_size(MALLOC_CAP_INTERNAL)),
+                (int)(uxTaskGetNumberOfTasks() - tasks_before),
+                (int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
 
 }
 
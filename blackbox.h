@@ -0,0 +1,320 @@
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "stream_stats.h"
+#include "log_ring.h"
+
+// 블랙박스. 사고가 났을 때 볼 수 있도록 최근 몇 초의 JPEG 프레임과
+// /ws, /alt_ws 로 받은 제어 명령을 시각과 함께 PSRAM 링에 계속 기록한다.
+// 링이 차면 가장 오래된 기록부터 덮어쓴다. /blackbox 로 한 파일 (색인 + 기록) 로 내려받는다.
+// 내려받기는 제어 httpd 태스크가 아니라 스트림 전송 태스크가 보낸다 (app_server.h).
+//
+// 카메라 버퍼는 곧 드라이버에 돌려줘야 하므로 캡처 태스크에서 프레임을 링으로 한 번 복사한다
+// (BLACKBOX_FRAME_EVERY 프레임마다 하나). 그 외의 복사는 없고, 내려받을 때도 링에서 바로 보낸다.
+// 내려받는 동안에는 링을 얼려서 (기록을 건너뜀) 사고 장면이 덮어써지지 않게 한다.
+//
+// 내려받는 파일 형식 (little endian)
+//   blackbox_archive_hdr_t
+//   blackbox_index_t x count   (기록마다 종류, 프레임 번호, 시각, 파일 안 위치, 길이)
+//   기록 데이터 (JPEG 또는 명령 JSON) 를 색인 순서대로 이어붙임
+
+#define BLACKBOX_ENABLE 1
+#define BLACKBOX_BYTES (1536 * 1024)   // PSRAM 에 잡을 링 크기 (QVGA 10 KB, 7.5 fps 면 약 20 초)
+#define BLACKBOX_FRAME_EVERY 2         // 몇 프레임마다 하나씩 기록할지
+#define BLACKBOX_CMD_MAX 256           // 명령 하나의 최대 길이
+
+typedef enum {
+    BLACKBOX_PAD = 0,      // 링 끝의 남는 자리 (읽을 때 건너뜀)
+    BLACKBOX_FRAME = 1,    // JPEG 프레임
+    BLACKBOX_COMMAND = 2,  // 제어 명령 (WebSocket 메시지 그대로)
+} blackbox_type_t;
+
+// 명령의 출처
+#define BLACKBOX_SRC_HP 0  // /ws
+#define BLACKBOX_SRC_PC 1  // /alt_ws
+
+typedef struct {
+    uint8_t type;          // blackbox_type_t
+    uint8_t src;           // 명령의 출처
+    uint16_t reserved;
+    uint32_t rec_len;      // 헤더 포함, 4 바이트 정렬된 기록 길이
+    uint32_t len;          // 데이터 길이
+    uint32_t seq;          // 프레임 번호 (명령이면 그때 게시된 프레임 번호)
+    int64_t ts_us;         // 시각 (esp_timer, 프레임이면 캡처 시각)
+} blackbox_rec_t;
+
+typedef struct __attribute__((packed)) {
+    char magic[4];         // "BBX1"
+    uint32_t count;        // 색인 수
+    uint32_t data_offset;  // 첫 기록 데이터의 파일 안 위치
+    uint32_t reserved;
+} blackbox_archive_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t src;
+    uint16_t reserved;
+    uint32_t seq;
+    int64_t ts_us;
+    uint32_t offset;       // 파일 안 위치
+    uint32_t len;
+} blackbox_index_t;
+
+typedef struct {
+    uint8_t *ring;         // NULL 이면 꺼짐
+    size_t size;
+    size_t head;           // 다음 기록을 쓸 위치
+    size_t tail;           // 가장 오래된 기록 위치
+    bool behind;           // head 가 링 끝에서 돌아와 tail 앞에 있음
+    uint32_t count;        // 링에 있는 기록 수
+    bool frozen;           // 내려받는 중 (기록하지 않음)
+    int frame_skip;        // BLACKBOX_FRAME_EVERY 를 세는 카운터 (캡처 태스크)
+    // 통계
+    uint32_t frames;       // 기록한 프레임 수
+    uint32_t commands;     // 기록한 명령 수
+    uint32_t overwritten;  // 덮어쓴 기록 수
+    uint32_t skipped;      // 얼어 있거나 바빠서 기록하지 못한 수
+    uint32_t commands_skipped;  // 그중 명령 (skipped 에 포함)
+    uint64_t bytes;        // 기록한 바이트 수
+    stats_hist_t write_us; // 프레임 하나를 기록하는 데 걸린 시간 (캡처 태스크)
+} blackbox_t;
+
+static blackbox_t blackbox;
+static SemaphoreHandle_t blackbox_lock = NULL;
+
+#define BLACKBOX_ALIGN(n) (((n) + 3) & ~(size_t)3)
+
+void blackbox_init() {
+    memset(&blackbox, 0, sizeof(blackbox));
+    stats_hist_reset(&blackbox.write_us);
+    if (!BLACKBOX_ENABLE || !psramFound()) {
+        Serial.println("Blackbox disabled (no PSRAM)");
+        return;
+    }
+    blackbox.ring = (uint8_t *)heap_caps_malloc(BLACKBOX_BYTES, MALLOC_CAP_SPIRAM);
+    if (!blackbox.ring) {
+        Serial.println("Failed to allocate blackbox ring");
+        return;
+    }
+    blackbox.size = BLACKBOX_BYTES;
+    blackbox_lock = xSemaphoreCreateMutex();
+    Serial.printf("Blackbox ring %d KB in PSRAM\n", BLACKBOX_BYTES / 1024);
+}
+
+static inline blackbox_rec_t *blackbox_rec_at(size_t pos) {
+    return (blackbox_rec_t *)(blackbox.ring + pos);
+}
+
+// pos 에 기록이 없으면 (링 끝의 남는 자리) 링 처음으로 돌아간다
+static inline bool blackbox_at_end(size_t pos) {
+    return blackbox.size - pos < sizeof(blackbox_rec_t) || blackbox_rec_at(pos)->type == BLACKBOX_PAD;
+}
+
+// 가장 오래된 기록을 버린다
+static void blackbox_drop_oldest() {
+    blackbox.tail += blackbox_rec_at(blackbox.tail)->rec_len;
+    blackbox.count--;
+    blackbox.overwritten++;
+    if (blackbox.count > 0 && blackbox_at_end(blackbox.tail)) {
+        blackbox.tail = 0;
+        blackbox.behind = false;
+    }
+}
+
+// head 에 rec_len 바이트 자리를 만든다 (오래된 기록을 덮어쓴다)
+static void blackbox_reserve(size_t rec_len) {
+    while (true) {
+        if (blackbox.count == 0) {
+            blackbox.head = blackbox.tail = 0;
+            blackbox.behind = false;
+        }
+        if (!blackbox.behind) {
+            if (blackbox.size - blackbox.head >= rec_len) {
+                return;
+            }
+            // 링 끝에 남는 자리를 표시하고 처음으로 돌아간다
+            if (blackbox.size - blackbox.head >= sizeof(blackbox_rec_t)) {
+                blackbox_rec_at(blackbox.head)->type = BLACKBOX_PAD;
+            }
+            blackbox.head = 0;
+            blackbox.behind = true;
+            continue;
+        }
+        if (blackbox.tail - blackbox.head >= rec_len) {
+            return;
+        }
+        blackbox_drop_oldest();
+    }
+}
+
+// 기록 하나를 추가한다. wait 이 false 면 다른 쪽이 쓰고 있을 때 기다리지 않고 건너뛴다.
+static bool blackbox_append(uint8_t type, uint8_t src, uint32_t seq, int64_t ts_us,
+                            const void *data, size_t len, bool wait) {
+    size_t rec_len = BLACKBOX_ALIGN(sizeof(blackbox_rec_t) + len);
+    if (!blackbox.ring || rec_len > blackbox.size / 4) {
+        return false;
+    }
+    if (__atomic_load_n(&blackbox.frozen, __ATOMIC_ACQUIRE) || !xSemaphoreTake(blackbox_lock, wait ? portMAX_DELAY : 0)) {
+        __atomic_add_fetch(&blackbox.skipped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    if (__atomic_load_n(&blackbox.frozen, __ATOMIC_ACQUIRE)) {  // 잠금을 기다리는 사이에 얼었다
+        xSemaphoreGive(blackbox_lock);
+        __atomic_add_fetch(&blackbox.skipped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    blackbox_reserve(rec_len);
+    blackbox_rec_t *rec = blackbox_rec_at(blackbox.head);
+    rec->type = type;
+    rec->src = src;
+    rec->reserved = 0;
+    rec->rec_len = rec_len;
+    rec->len = len;
+    rec->seq = seq;
+    rec->ts_us = ts_us;
+    memcpy(rec + 1, data, len);
+    blackbox.head += rec_len;
+    blackbox.count++;
+    blackbox.bytes += rec_len;
+    xSemaphoreGive(blackbox_lock);
+    return true;
+}
+
+// 캡처 태스크에서 프레임을 게시하기 전에 호출한다 (seq 는 게시될 프레임 번호)
+void blackbox_frame(const camera_fb_t *fb, uint32_t seq, int64_t captured_us) {
+    if (!blackbox.ring || ++blackbox.frame_skip < BLACKBOX_FRAME_EVERY) {
+        return;
+    }
+    blackbox.frame_skip = 0;
+    int64_t start = esp_timer_get_time();
+    // 캡처 태스크는 기다리지 않는다 (내려받는 중이거나 명령을 쓰는 중이면 건너뜀)
+    if (blackbox_append(BLACKBOX_FRAME, 0, seq, captured_us, fb->buf, fb->len, false)) {
+        blackbox.frames++;
+        stats_hist_add(&blackbox.write_us, esp_timer_get_time() - start, fb->len);
+    }
+}
+
+// WebSocket 제어 명령을 기록한다 (httpd 태스크).
+// 캡처 태스크가 프레임을 쓰는 중이면 기다리지 않고 건너뛴다. 조향 명령 처리가 PSRAM 복사를 기다리면 안 된다.
+void blackbox_command(uint8_t src, uint32_t seq, const uint8_t *data, size_t len) {
+    if (!blackbox.ring) {
+        return;
+    }
+    if (len > BLACKBOX_CMD_MAX) {
+        len = BLACKBOX_CMD_MAX;
+    }
+    if (blackbox_append(BLACKBOX_COMMAND, src, seq, esp_timer_get_time(), data, len, false)) {
+        __atomic_add_fetch(&blackbox.commands, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&blackbox.commands_skipped, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// 내려받기 (/blackbox, app_server.h). 전송 태스크에서 보내는 동안 링을 얼려둔다.
+typedef esp_err_t (*blackbox_write_fn_t)(void *arg, const void *data, size_t len);
+
+// 링을 얼리고 (기록을 멈추고) 내려받을 파일 크기를 archive_len 에 돌려준다.
+// 이미 다른 쪽이 내려받는 중이면 false. 성공하면 반드시 blackbox_thaw() 를 부른다.
+bool blackbox_freeze(size_t *archive_len) {
+    if (!blackbox.ring || __atomic_exchange_n(&blackbox.frozen, true, __ATOMIC_ACQ_REL)) {
+        return false;
+    }
+    // 쓰고 있던 기록이 끝나기를 기다린다. 그 뒤로는 아무도 링을 바꾸지 않는다.
+    xSemaphoreTake(blackbox_lock, portMAX_DELAY);
+    xSemaphoreGive(blackbox_lock);
+    size_t len = sizeof(blackbox_archive_hdr_t) + blackbox.count * sizeof(blackbox_index_t);
+    size_t pos = blackbox.tail;
+    for (uint32_t i = 0; i < blackbox.count; i++) {
+        if (blackbox_at_end(pos)) {
+            pos = 0;
+        }
+        len += blackbox_rec_at(pos)->len;
+        pos += blackbox_rec_at(pos)->rec_len;
+    }
+    *archive_len = len;
+    return true;
+}
+
+// 얼린 링의 색인과 기록을 한 파일로 write 에 넘긴다. 기록 데이터는 링에서 바로 보낸다.
+esp_err_t blackbox_write_archive(blackbox_write_fn_t write, void *arg) {
+    size_t tail = blackbox.tail;
+    uint32_t count = blackbox.count;
+
+    blackbox_archive_hdr_t hdr;
+    memcpy(hdr.magic, "BBX1", 4);
+    hdr.count = count;
+    hdr.data_offset = sizeof(hdr) + count * sizeof(blackbox_index_t);
+    hdr.reserved = 0;
+    esp_err_t res = write(arg, &hdr, sizeof(hdr));
+
+    // 색인 (몇 개씩 모아서 보낸다)
+    blackbox_index_t index[8];
+    int n = 0;
+    size_t pos = tail;
+    uint32_t offset = hdr.data_offset;
+    for (uint32_t i = 0; i < count && res == ESP_OK; i++) {
+        if (blackbox_at_end(pos)) {
+            pos = 0;
+        }
+        const blackbox_rec_t *rec = blackbox_rec_at(pos);
+        index[n].type = rec->type;
+        index[n].src = rec->src;
+        index[n].reserved = 0;
+        index[n].seq = rec->seq;
+        index[n].ts_us = rec->ts_us;
+        index[n].offset = offset;
+        index[n].len = rec->len;
+        offset += rec->len;
+        pos += rec->rec_len;
+        if (++n == 8 || i == count - 1) {
+            res = write(arg, index, n * sizeof(blackbox_index_t));
+            n = 0;
+        }
+    }
+
+    pos = tail;
+    for (uint32_t i = 0; i < count && res == ESP_OK; i++) {
+        if (blackbox_at_end(pos)) {
+            pos = 0;
+        }
+        const blackbox_rec_t *rec = blackbox_rec_at(pos);
+        if (rec->len > 0) {
+            res = write(arg, rec + 1, rec->len);
+        }
+        pos += rec->rec_len;
+    }
+    LOG_I("Blackbox sent %d records%s", (int)count, res == ESP_OK ? "" : " (aborted)");
+    return res;
+}
+
+// 기록을 다시 시작한다. clear 면 링을 비운다.
+void blackbox_thaw(bool clear) {
+    if (clear) {
+        blackbox.count = 0;
+    }
+    __atomic_store_n(&blackbox.frozen, false, __ATOMIC_RELEASE);
+}
+
+// /stats 용 JSON. span_ms 는 링에 남아 있는 가장 오래된 기록부터 지금까지의 시간.
+int blackbox_json(char *buf, size_t len) {
+    int64_t span_us = 0;
+    if (blackbox.ring && blackbox.count > 0) {
+        span_us = esp_timer_get_time() - blackbox_rec_at(blackbox.tail)->ts_us;
+    }
+    int n = snprintf(buf, len, "{\"ring_kb\":%u,\"records\":%u,\"span_ms\":%d,\"frames\":%u,\"commands\":%u,"
+                     "\"overwritten\":%u,\"skipped\":%u,\"commands_skipped\":%u,\"write_us\":",
+                     (unsigned)(blackbox.size / 1024), (unsigned)blackbox.count, (int)(span_us / 1000),
+                     (unsigned)blackbox.frames, (unsigned)blackbox.commands,
+                     (unsigned)blackbox.overwritten, (unsigned)blackbox.skipped,
+                     (unsigned)blackbox.commands_skipped);
+    n = stats_json_fit(n, len);
+    n += stats_summary_json(buf + n, len - n, &blackbox.write_us);
+    n += stats_json_fit(snprintf(buf + n, len - n, "}"), len - n);
+    return n;
+}
+
+#endif  // BLACKBOX_H
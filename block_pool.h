@@ -0,0 +1,137 @@
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include "Arduino.h"
+#include "esp_heap_caps.h"
+#include "stream_stats.h"
+
+// 고정 크기 블록 풀. 오래 돌면 크기가 제각각인 malloc/free 로 내부 힙이 조각나서
+// 큰 할당이 실패하므로, 자주 쓰는 버퍼는 부팅 때 한 번 잡아둔 블록에서 꺼내 쓴다.
+// PSRAM 이 있으면 PSRAM 에, 없으면 내부 RAM 에 잡는다.
+// 할당/해제는 빈 블록 리스트의 머리만 바꾸므로 O(1) 이다.
+//
+//   small : WebSocket 제어 연결 (/ws, /alt_ws) 의 수신 버퍼 (ws_rx.h)
+//   large : 텐서 모드 출력 버퍼 등 JPEG 크기의 버퍼
+//
+// 맞는 크기 클래스가 없거나 블록이 모두 쓰이고 있으면 heap_caps_malloc 으로 대신 할당한다
+// (fallbacks 로 센다). block_free 는 주소로 어느 쪽인지 알아낸다.
+
+#define POOL_SMALL_SIZE 256
+#define POOL_SMALL_COUNT 16
+#define POOL_LARGE_SIZE (32 * 1024)
+#define POOL_LARGE_COUNT_PSRAM 4
+#define POOL_LARGE_COUNT_INTERNAL 1  // PSRAM 이 없으면 내부 RAM 이 모자라므로 하나만
+
+typedef struct {
+    const char *name;
+    size_t block_size;
+    int blocks;
+    uint8_t *base;        // 블록 영역 시작 (blocks * block_size)
+    void *free_head;      // 빈 블록 리스트. 빈 블록의 처음 4 바이트에 다음 빈 블록 주소를 둔다
+    int used;             // 쓰고 있는 블록 수
+    int peak;             // used 의 최대값
+    uint32_t allocs;      // 이 풀에서 꺼낸 횟수
+    uint32_t fallbacks;   // 풀이 비어서 (또는 크기가 맞지 않아서) 힙에서 대신 할당한 횟수
+} block_pool_t;
+
+#define POOL_CLASSES 2
+static block_pool_t block_pools[POOL_CLASSES] = {
+    { "small", POOL_SMALL_SIZE },
+    { "large", POOL_LARGE_SIZE },
+};
+static portMUX_TYPE block_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t block_pool_caps = MALLOC_CAP_8BIT;
+
+static void block_pool_setup(block_pool_t *pool, int blocks) {
+    pool->base = (uint8_t *)heap_caps_malloc(pool->block_size * blocks, block_pool_caps);
+    if (!pool->base) {
+        Serial.printf("Failed to allocate %s block pool\n", pool->name);
+        pool->blocks = 0;
+        return;
+    }
+    pool->blocks = blocks;
+    pool->free_head = NULL;
+    for (int i = blocks - 1; i >= 0; i--) {
+        void *block = pool->base + i * pool->block_size;
+        *(void **)block = pool->free_head;
+        pool->free_head = block;
+    }
+}
+
+void block_pool_init() {
+    block_pool_caps = psramFound() ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT;
+    block_pool_setup(&block_pools[0], POOL_SMALL_COUNT);
+    block_pool_setup(&block_pools[1], psramFound() ? POOL_LARGE_COUNT_PSRAM : POOL_LARGE_COUNT_INTERNAL);
+    Serial.printf("Block pools in %s: %d x %d, %d x %d bytes\n", psramFound() ? "PSRAM" : "internal RAM",
+                  block_pools[0].blocks, (int)block_pools[0].block_size,
+                  block_pools[1].blocks, (int)block_pools[1].block_size);
+}
+
+// size 바이트 이상인 블록을 돌려준다. 실패하면 NULL.
+void *block_alloc(size_t size) {
+    for (int i = 0; i < POOL_CLASSES; i++) {
+        block_pool_t *pool = &block_pools[i];
+        if (size > pool->block_size) {
+            continue;
+        }
+        void *block = NULL;
+        portENTER_CRITICAL(&block_pool_lock);
+        if (pool->free_head) {
+            block = pool->free_head;
+            pool->free_head = *(void **)block;
+            pool->allocs++;
+            if (++pool->used > pool->peak) {
+                pool->peak = pool->used;
+            }
+        } else {
+            pool->fallbacks++;
+        }
+        portEXIT_CRITICAL(&block_pool_lock);
+        if (block) {
+            return block;
+        }
+        break;  // 더 큰 클래스는 아껴둔다
+    }
+    if (size > POOL_LARGE_SIZE) {
+        portENTER_CRITICAL(&block_pool_lock);
+        block_pools[POOL_CLASSES - 1].fallbacks++;
+        portEXIT_CRITICAL(&block_pool_lock);
+    }
+    return heap_caps_malloc(size, block_pool_caps);
+}
+
+void block_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    for (int i = 0; i < POOL_CLASSES; i++) {
+        block_pool_t *pool = &block_pools[i];
+        uint8_t *p = (uint8_t *)ptr;
+        if (pool->base && p >= pool->base && p < pool->base + pool->blocks * pool->block_size) {
+            portENTER_CRITICAL(&block_pool_lock);
+            *(void **)ptr = pool->free_head;
+            pool->free_head = ptr;
+            pool->used--;
+            portEXIT_CRITICAL(&block_pool_lock);
+            return;
+        }
+    }
+    heap_caps_free(ptr);  // 풀이 모자라서 힙에서 받은 블록
+}
+
+// /stats 용 JSON 배열
+int block_pool_json(char *buf, size_t len) {
+    int n = stats_json_fit(snprintf(buf, len, "["), len);
+    for (int i = 0; i < POOL_CLASSES; i++) {
+        const block_pool_t *pool = &block_pools[i];
+        int m = snprintf(buf + n, len - n, "%s{\"name\":\"%s\",\"size\":%u,\"blocks\":%d,\"used\":%d,\"peak\":%d,"
+                         "\"allocs\":%u,\"fallbacks\":%u}",
+                         i ? "," : "", pool->name, (unsigned)pool->block_size, pool->blocks, pool->used,
+                         pool->peak, (unsigned)pool->allocs, (unsigned)pool->fallbacks);
+        n += stats_json_fit(m, len - n);
+    }
+    n += stats_json_fit(snprintf(buf + n, len - n, "]"), len - n);
+    return n;
+}
+
+#endif  // BLOCK_POOL_H
@@ -0,0 +1,129 @@
+#ifndef CONTROL_PROTO_H
+#define CONTROL_PROTO_H
+
+#include "Arduino.h"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "stream_stats.h"
+
+// 바이너리 제어 메시지. 50~100 Hz 로 오는 조향 명령을 JSON 파싱 없이 처리하기 위해
+// /ws, /alt_ws 의 WebSocket 바이너리 프레임으로 받는다 (텍스트 프레임은 예전처럼 JSON).
+//
+// 형식 (little endian, 12 바이트)
+//   version u8 | opcode u8 | flags u16 | seq u32 | angle i16 | speed i16
+// 같은 version 에서 뒤에 필드가 늘어날 수 있으므로 12 바이트보다 긴 메시지도 받는다.
+// GET_SPEED 의 응답도 같은 형식 (opcode GET_SPEED, 받은 seq, 현재 angle/speed) 이다.
+// TELEMETRY 로 구독하면 차가 같은 머리 뒤에 상태 필드를 붙인 ctrl_telemetry_t 를 주기적으로 보낸다.
+
+#define CTRL_PROTO_VERSION 1
+
+typedef enum {
+    CTRL_OP_MOVE = 1,       // angle, speed (/ws 는 저장된 속도를 쓴다)
+    CTRL_OP_STOP = 2,
+    CTRL_OP_LED = 3,        // flags & CTRL_FLAG_ON
+    CTRL_OP_SET_SPEED = 4,  // speed 를 EEPROM 에 저장
+    CTRL_OP_GET_SPEED = 5,  // 현재 angle/speed 를 바이너리로 돌려준다
+    CTRL_OP_TELEMETRY = 6,  // flags & CTRL_FLAG_ON 이면 speed Hz 로 ctrl_telemetry_t 를 받는다
+} ctrl_opcode_t;
+
+#define CTRL_FLAG_ON 0x0001
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t opcode;
+    uint16_t flags;
+    uint32_t seq;
+    int16_t angle;
+    int16_t speed;
+} ctrl_msg_t;
+
+// 차 -> PC 상태 메시지 (32 바이트). 머리의 seq 는 보낸 메시지 번호, angle/speed 는 현재 값.
+typedef struct __attribute__((packed)) {
+    ctrl_msg_t hdr;         // opcode CTRL_OP_TELEMETRY
+    uint32_t frame_seq;     // 마지막으로 게시된 프레임 번호
+    uint32_t free_heap;
+    uint32_t capture_us;    // 캡처 간격 p50
+    uint32_t motor_us;      // 모터 명령 -> I2C 지연 p50
+    int8_t rssi;            // dBm
+    uint8_t reserved[3];
+} ctrl_telemetry_t;
+
+// 제어 메시지 통계. 두 경로의 파싱 + 처리 시간을 비교할 수 있다.
+typedef struct {
+    uint32_t json;          // 처리한 JSON 메시지 수
+    uint32_t binary;        // 처리한 바이너리 메시지 수
+    uint32_t bad;           // 형식이나 버전이 맞지 않는 메시지 수
+    uint32_t last_seq;      // 마지막 바이너리 메시지의 seq
+    stats_hist_t json_us;   // JSON 파싱 + 처리 시간
+    stats_hist_t binary_us; // 바이너리 파싱 + 처리 시간
+} ctrl_stats_t;
+
+static ctrl_stats_t ctrl_stats;
+// httpd 서버가 여러 개면 여러 태스크가 통계를 쓰므로 잠근다
+static portMUX_TYPE ctrl_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void ctrl_stats_init() {
+    memset(&ctrl_stats, 0, sizeof(ctrl_stats));
+    stats_hist_reset(&ctrl_stats.json_us);
+    stats_hist_reset(&ctrl_stats.binary_us);
+}
+
+// 바이너리 메시지를 읽는다. 길이나 버전이 맞지 않으면 false.
+static inline bool ctrl_parse(const uint8_t *buf, size_t len, ctrl_msg_t *msg) {
+    if (len < sizeof(ctrl_msg_t) || buf[0] != CTRL_PROTO_VERSION) {
+        return false;
+    }
+    memcpy(msg, buf, sizeof(ctrl_msg_t));  // ESP32 는 little endian
+    return true;
+}
+
+// 메시지 하나를 처리한 시간을 기록한다
+void ctrl_record(bool binary, int64_t start_us) {
+    uint32_t us = esp_timer_get_time() - start_us;
+    portENTER_CRITICAL(&ctrl_stats_lock);
+    if (binary) {
+        ctrl_stats.binary++;
+        stats_hist_add(&ctrl_stats.binary_us, us, 0);
+    } else {
+        ctrl_stats.json++;
+        stats_hist_add(&ctrl_stats.json_us, us, 0);
+    }
+    portEXIT_CRITICAL(&ctrl_stats_lock);
+}
+
+void ctrl_record_bad() {
+    __atomic_add_fetch(&ctrl_stats.bad, 1, __ATOMIC_RELAXED);
+}
+
+// GET_SPEED 응답을 바이너리 프레임으로 보낸다
+esp_err_t ctrl_send_reply(httpd_req_t *req, const ctrl_msg_t *in, int angle, int speed) {
+    ctrl_msg_t out;
+    out.version = CTRL_PROTO_VERSION;
+    out.opcode = in->opcode;
+    out.flags = 0;
+    out.seq = in->seq;
+    out.angle = angle;
+    out.speed = speed;
+
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = HTTPD_WS_TYPE_BINARY;
+    frame.payload = (uint8_t *)&out;
+    frame.len = sizeof(out);
+    return httpd_ws_send_frame(req, &frame);
+}
+
+// /stats 용 JSON
+int ctrl_stats_json(char *buf, size_t len) {
+    int n = snprintf(buf, len, "{\"json\":%u,\"binary\":%u,\"bad\":%u,\"last_seq\":%u,\"json_us\":",
+                     (unsigned)ctrl_stats.json, (unsigned)ctrl_stats.binary, (unsigned)ctrl_stats.bad,
+                     (unsigned)ctrl_stats.last_seq);
+    n = stats_json_fit(n, len);
+    n += stats_summary_json(buf + n, len - n, &ctrl_stats.json_us);
+    n += stats_json_fit(snprintf(buf + n, len - n, ",\"binary_us\":"), len - n);
+    n += stats_summary_json(buf + n, len - n, &ctrl_stats.binary_us);
+    n += stats_json_fit(snprintf(buf + n, len - n, "}"), len - n);
+    return n;
+}
+
+#endif  // CONTROL_PROTO_H
@@ -0,0 +1,180 @@
+#ifndef CTRL_DISPATCH_H
+#define CTRL_DISPATCH_H
+
+#include <type_traits>
+#include <ArduinoJson.h>
+#include "Arduino.h"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "control_proto.h"
+
+// 제어 명령 표. /ws (핸드폰) 와 /alt_ws (PC) 가 같은 표를 쓴다.
+// 명령마다 엔드포인트별 처리 함수를 등록해두고 (startCameraServer 에서 한 번),
+// 받은 "cmd" 문자열의 해시로 표를 찾는다. 등록할 이름의 해시는 컴파일 때 계산된다 (CMD_HASH).
+// 표는 CMD_SLOTS 칸 (명령 수의 두 배 이상) 의 열린 주소 해시라서 명령이 늘어도
+// 찾는 데 드는 비교 횟수는 거의 그대로다 (/stats 의 cmds.probe_max).
+// 바이너리 메시지 (control_proto.h) 도 opcode 를 이름으로 바꿔 같은 표로 처리한다.
+
+#define CMD_EP_HP 0   // /ws
+#define CMD_EP_PC 1   // /alt_ws
+#define CMD_EP_COUNT 2
+#define CMD_EP_MASK(ep) (1 << (ep))
+
+#define CMD_MAX 16
+#define CMD_SLOTS 32  // 2 의 거듭제곱, CMD_MAX 의 두 배 이상
+
+// FNV-1a
+constexpr uint32_t cmd_hash(const char *s, uint32_t h = 2166136261u) {
+    return *s ? cmd_hash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+#define CMD_HASH(name) (std::integral_constant<uint32_t, cmd_hash(name)>::value)
+
+// 처리 함수에 넘기는 인자. JSON 과 바이너리에서 같은 필드를 채운다.
+typedef struct {
+    httpd_req_t *req;
+    int ep;                  // CMD_EP_HP / CMD_EP_PC
+    const char *state;       // "on", "off" 등 (없으면 "")
+    int angle;
+    int speed;
+    JsonDocument *doc;       // JSON 명령이면 문서 (추가 필드용), 바이너리면 NULL
+    const ctrl_msg_t *bin;   // 바이너리 명령이면 메시지, JSON 이면 NULL
+} cmd_args_t;
+
+typedef void (*cmd_fn_t)(const cmd_args_t *args);
+
+typedef struct {
+    uint32_t hash;
+    const char *name;
+    cmd_fn_t fn[CMD_EP_COUNT];  // NULL 이면 그 엔드포인트에서는 받지 않는다
+    uint32_t calls;
+    uint64_t total_us;          // 처리 함수에서 보낸 시간 합
+    uint32_t max_us;
+} cmd_entry_t;
+
+static cmd_entry_t cmd_entries[CMD_MAX];
+static int cmd_count;
+static int8_t cmd_slots[CMD_SLOTS];  // 해시 칸 -> cmd_entries 번호 (-1 = 빈칸)
+static uint32_t cmd_unknown;         // 표에 없거나 그 엔드포인트에서 받지 않는 명령 수
+static int cmd_probe_max;            // 찾을 때 본 칸 수의 최대값
+static portMUX_TYPE cmd_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 바이너리 opcode -> 명령 이름 (control_proto.h 의 ctrl_opcode_t 순서)
+static const char *const cmd_op_names[] = { NULL, "move", "stop", "led", "set_speed", "get_speed", "telemetry" };
+static const uint32_t cmd_op_hashes[] = {
+    0, CMD_HASH("move"), CMD_HASH("stop"), CMD_HASH("led"), CMD_HASH("set_speed"), CMD_HASH("get_speed"),
+    CMD_HASH("telemetry"),
+};
+
+void cmd_table_init() {
+    memset(cmd_entries, 0, sizeof(cmd_entries));
+    memset(cmd_slots, -1, sizeof(cmd_slots));
+    cmd_count = 0;
+    cmd_unknown = 0;
+    cmd_probe_max = 0;
+}
+
+static int cmd_find(uint32_t hash, const char *name) {
+    int probes = 0;
+    for (uint32_t i = hash & (CMD_SLOTS - 1);; i = (i + 1) & (CMD_SLOTS - 1)) {
+        int idx = cmd_slots[i];
+        probes++;
+        if (idx < 0) {
+            idx = -1 - (int)i;  // 빈칸 (등록할 자리)
+        } else if (cmd_entries[idx].hash != hash || strcmp(cmd_entries[idx].name, name) != 0) {
+            continue;
+        }
+        if (probes > cmd_probe_max) {
+            cmd_probe_max = probes;
+        }
+        return idx;
+    }
+}
+
+// 시작할 때만 호출한다. 같은 이름을 다시 등록하면 ep_mask 의 엔드포인트 처리 함수를 바꾼다.
+bool cmd_register(uint32_t hash, const char *name, int ep_mask, cmd_fn_t fn) {
+    int idx = cmd_find(hash, name);
+    if (idx < 0) {
+        if (cmd_count >= CMD_MAX) {
+            Serial.printf("Command table full, %s not registered\n", name);
+            return false;
+        }
+        cmd_slots[-1 - idx] = cmd_count;
+        idx = cmd_count++;
+        cmd_entries[idx].hash = hash;
+        cmd_entries[idx].name = name;
+    }
+    for (int ep = 0; ep < CMD_EP_COUNT; ep++) {
+        if (ep_mask & CMD_EP_MASK(ep)) {
+            cmd_entries[idx].fn[ep] = fn;
+        }
+    }
+    return true;
+}
+#define CMD_REGISTER(name, ep_mask, fn) cmd_register(CMD_HASH(name), name, ep_mask, fn)
+
+// 명령 하나를 처리한다. 표에 없으면 false.
+bool cmd_dispatch(uint32_t hash, const char *name, const cmd_args_t *args) {
+    int idx = cmd_find(hash, name);
+    cmd_fn_t fn = idx >= 0 ? cmd_entries[idx].fn[args->ep] : NULL;
+    if (!fn) {
+        __atomic_add_fetch(&cmd_unknown, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    int64_t start_us = esp_timer_get_time();
+    fn(args);
+    uint32_t us = esp_timer_get_time() - start_us;
+
+    cmd_entry_t *e = &cmd_entries[idx];
+    portENTER_CRITICAL(&cmd_lock);
+    e->calls++;
+    e->total_us += us;
+    if (us > e->max_us) {
+        e->max_us = us;
+    }
+    portEXIT_CRITICAL(&cmd_lock);
+    return true;
+}
+
+// {"cmd": ..., "state": ..., "angle": ..., "speed": ...}
+bool cmd_dispatch_json(httpd_req_t *req, int ep, JsonDocument *doc) {
+    const char *cmd = (*doc)["cmd"] | "";
+    cmd_args_t args;
+    args.req = req;
+    args.ep = ep;
+    args.state = (*doc)["state"] | "";
+    args.angle = (*doc)["angle"] | 0;
+    args.speed = (*doc)["speed"] | 0;
+    args.doc = doc;
+    args.bin = NULL;
+    return cmd_dispatch(cmd_hash(cmd), cmd, &args);
+}
+
+bool cmd_dispatch_binary(httpd_req_t *req, int ep, const ctrl_msg_t *msg) {
+    if (msg->opcode == 0 || msg->opcode >= sizeof(cmd_op_names) / sizeof(cmd_op_names[0])) {
+        __atomic_add_fetch(&cmd_unknown, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    cmd_args_t args;
+    args.req = req;
+    args.ep = ep;
+    args.state = msg->flags & CTRL_FLAG_ON ? "on" : "off";
+    args.angle = msg->angle;
+    args.speed = msg->speed;
+    args.doc = NULL;
+    args.bin = msg;
+    return cmd_dispatch(cmd_op_hashes[msg->opcode], cmd_op_names[msg->opcode], &args);
+}
+
+// /stats 용. i 번째 명령의 JSON 객체, i 가 범위 밖이면 0.
+int cmd_entry_json(int i, char *buf, size_t len) {
+    if (i >= cmd_count) {
+        return 0;
+    }
+    const cmd_entry_t *e = &cmd_entries[i];
+    int n = snprintf(buf, len, "%s{\"name\":\"%s\",\"calls\":%u,\"avg_us\":%u,\"max_us\":%u}", i ? "," : "",
+                     e->name, (unsigned)e->calls, e->calls ? (unsigned)(e->total_us / e->calls) : 0,
+                     (unsigned)e->max_us);
+    return stats_json_fit(n, len);
+}
+
+#endif  // CTRL_DISPATCH_H
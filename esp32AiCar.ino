@@ -159,7 +159,7 @@ void setup() {
   if (psramFound()) {
     config.frame_size = FRAMESIZE_QVGA;
     config.jpeg_quality = 10;
-    config.fb_count = 2;
+    config.fb_count = 3;  // 느린 클라이언트가 버퍼 하나를 잡고 있어도 캡처가 멈추지 않도록
   } else {
     config.frame_size = FRAMESIZE_QVGA;
     config.jpeg_quality = 12;
@@ -171,6 +171,8 @@ void setup() {
     Serial.printf("Camera init failed with error 0x%x", err);
     return;
   }
+  camera_fb_count = config.fb_count;
+  adapt_init(config.frame_size, config.jpeg_quality);  // 적응형 품질 제어 시작 단계
   //drop down frame size for higher initial frame rate
   sensor_t* s = esp_camera_sensor_get();
   s->set_framesize(s, FRAMESIZE_QVGA);
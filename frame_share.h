@@ -0,0 +1,181 @@
+#ifndef FRAME_SHARE_H
+#define FRAME_SHARE_H
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "log_ring.h"
+
+// 캡처 태스크가 게시(publish)하고 스트림 핸들러가 빌려가는(borrow) 프레임 핸들.
+// 프레임을 복사하지 않고 camera_fb_t 를 참조 카운트로 공유한다.
+// 마지막 참조가 해제될 때만 esp_camera_fb_return() 으로 반환된다.
+typedef struct {
+    camera_fb_t *fb;
+    int refs;             // 게시 참조 1 + 전송 중인 클라이언트 수
+    uint32_t seq;         // 게시 순서 번호 (1 부터 증가)
+    int64_t captured_us;  // 캡처 시각 (esp_timer 기준, us)
+    bool still;           // 이전 프레임과 거의 같은 정지 화면 (still_frame.h)
+} frame_ref_t;
+
+// 프레임 링. 카메라 버퍼는 최대 fb_count 개만 밖에 나와 있을 수 있으므로
+// 링의 길이도 fb_count 로 충분하다. 캡처 태스크가 새 버퍼를 받았다면
+// 항상 비어있는 슬롯이 하나 이상 있다.
+// 게시 참조는 가장 최근 슬롯만 가지며, 이전 슬롯은 읽고 있는 클라이언트가
+// 끝나는 즉시 반환된다. 캡처 태스크는 락을 잡지 않으므로 느린 클라이언트를
+// 기다리지 않는다 (카메라 버퍼가 모두 잡혀 있을 때만 드라이버에서 기다린다).
+#define FRAME_RING_MAX 4
+
+static frame_ref_t frame_ring[FRAME_RING_MAX];
+static int frame_ring_len = 1;
+static int frame_latest = -1;               // 가장 최근에 게시된 슬롯 (-1 이면 없음)
+static uint32_t frame_seq = 0;              // 마지막으로 게시된 프레임 번호
+SemaphoreHandle_t xSemaphore = NULL;        // 구독자 등록을 위한 세마포어 (캡처 태스크는 사용하지 않음)
+int camera_fb_count = 1;                    // esp_camera_init 에 설정한 fb_count
+
+// 새 프레임을 기다리는 구독자. 게시할 때마다 각 구독자의 세마포어를 준다.
+#define FRAME_MAX_SUBSCRIBERS 4
+
+typedef struct {
+    bool used;
+    SemaphoreHandle_t sem;
+} frame_sub_t;
+
+static frame_sub_t frame_subs[FRAME_MAX_SUBSCRIBERS];
+
+void frame_share_init() {
+    xSemaphore = xSemaphoreCreateMutex();
+    memset(frame_ring, 0, sizeof(frame_ring));
+    frame_ring_len = constrain(camera_fb_count, 1, FRAME_RING_MAX);
+    frame_latest = -1;
+    frame_seq = 0;
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        frame_subs[i].used = false;
+        frame_subs[i].sem = xSemaphoreCreateBinary();
+    }
+}
+
+// 구독자 등록. 빈 자리가 없으면 -1.
+int frame_subscribe() {
+    int sub = -1;
+
+    if (xSemaphoreTake(xSemaphore, portMAX_DELAY)) {
+        for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+            if (!frame_subs[i].used) {
+                xSemaphoreTake(frame_subs[i].sem, 0);  // 이전 사용자의 알림 제거
+                __atomic_store_n(&frame_subs[i].used, true, __ATOMIC_RELEASE);
+                sub = i;
+                break;
+            }
+        }
+        xSemaphoreGive(xSemaphore);
+    }
+    return sub;
+}
+
+void frame_unsubscribe(int sub) {
+    if (sub < 0 || sub >= FRAME_MAX_SUBSCRIBERS) {
+        return;
+    }
+    if (xSemaphoreTake(xSemaphore, portMAX_DELAY)) {
+        __atomic_store_n(&frame_subs[sub].used, false, __ATOMIC_RELEASE);
+        xSemaphoreGive(xSemaphore);
+    }
+}
+
+// 참조를 하나 줄이고 0 이 되면 카메라 드라이버에 버퍼를 돌려준다.
+void frame_release(frame_ref_t *frame) {
+    if (!frame) {
+        return;
+    }
+    if (__atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        camera_fb_t *fb = frame->fb;
+        // fb 를 비우는 순간부터 캡처 태스크가 이 슬롯을 다시 쓸 수 있다
+        __atomic_store_n(&frame->fb, (camera_fb_t *)NULL, __ATOMIC_RELEASE);
+        esp_camera_fb_return(fb);
+    }
+}
+
+// 현재 게시된 가장 최근 프레임의 참조를 얻는다. 프레임이 없으면 NULL.
+frame_ref_t *frame_acquire() {
+    while (true) {
+        int idx = __atomic_load_n(&frame_latest, __ATOMIC_ACQUIRE);
+        if (idx < 0) {
+            return NULL;
+        }
+        frame_ref_t *frame = &frame_ring[idx];
+        int refs = __atomic_load_n(&frame->refs, __ATOMIC_ACQUIRE);
+        // 참조가 0 이 된 슬롯은 이미 반환 중이므로 되살리지 않는다
+        while (refs > 0) {
+            if (__atomic_compare_exchange_n(&frame->refs, &refs, refs + 1, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return frame;
+            }
+        }
+        // 그 사이 새 프레임이 게시되었으므로 다시 읽는다
+    }
+}
+
+// last_seq 보다 새로운 프레임이 게시될 때까지 기다렸다가 참조를 얻는다.
+// 중간에 게시된 이전 프레임들은 건너뛴다. timeout 안에 새 프레임이 없으면 NULL.
+frame_ref_t *frame_wait(int sub, uint32_t last_seq, TickType_t timeout) {
+    while (true) {
+        frame_ref_t *frame = frame_acquire();
+        if (frame && (int32_t)(frame->seq - last_seq) > 0) {
+            return frame;
+        }
+        frame_release(frame);
+        if (sub < 0 || !xSemaphoreTake(frame_subs[sub].sem, timeout)) {
+            return NULL;
+        }
+    }
+}
+
+// 새 프레임을 게시한다. 이전 프레임의 게시 참조는 해제된다.
+// fb 가 NULL 이면 현재 프레임의 게시만 취소한다.
+// 캡처 태스크 하나에서만 호출해야 한다.
+// 게시한 프레임 번호를 돌려준다. 버렸거나 게시 취소면 0.
+// 게시 참조는 다음 frame_publish 까지 남으므로 그 전까지는 캡처 태스크가 fb 를 더 읽어도 된다.
+uint32_t frame_publish(camera_fb_t *fb, bool still = false) {
+    int idx = -1;
+
+    if (fb) {
+        int start = frame_latest < 0 ? 0 : frame_latest + 1;
+        for (int i = 0; i < frame_ring_len; i++) {
+            int n = (start + i) % frame_ring_len;
+            if (__atomic_load_n(&frame_ring[n].refs, __ATOMIC_ACQUIRE) == 0 &&
+                __atomic_load_n(&frame_ring[n].fb, __ATOMIC_ACQUIRE) == NULL) {
+                idx = n;
+                break;
+            }
+        }
+        if (idx < 0) {
+            // 빈 슬롯이 없으면 이 프레임은 버린다
+            LOG_W("No free frame slot, dropping frame");
+            esp_camera_fb_return(fb);
+            return 0;
+        }
+        frame_ref_t *slot = &frame_ring[idx];
+        slot->fb = fb;
+        slot->seq = ++frame_seq;
+        slot->captured_us = (int64_t)fb->timestamp.tv_sec * 1000000LL + fb->timestamp.tv_usec;
+        slot->still = still;
+        __atomic_store_n(&slot->refs, 1, __ATOMIC_RELEASE);  // 게시 참조
+    }
+
+    int old = __atomic_exchange_n(&frame_latest, idx, __ATOMIC_ACQ_REL);
+    if (old >= 0) {
+        frame_release(&frame_ring[old]);
+    }
+
+    if (fb) {
+        // 기다리고 있는 스트림 핸들러를 깨운다
+        for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+            if (__atomic_load_n(&frame_subs[i].used, __ATOMIC_ACQUIRE)) {
+                xSemaphoreGive(frame_subs[i].sem);
+            }
+        }
+    }
+    return fb ? frame_seq : 0;
+}
+
+#endif  // FRAME_SHARE_H
@@ -8,6 +8,12 @@
 
 #include <EEPROM.h>
 #include "setMotor.h"
+#include "ws_rx.h"
+#include "frame_share.h"
+#include "blackbox.h"
+#include "ctrl_dispatch.h"
+#include "motor_task.h"
+#include "log_ring.h"
 
 #define LED_BUILTIN 4
 
@@ -17,87 +23,90 @@ extern int car_speed;  // 동작스피드
 extern int set_speed;  // 셋팅엥글
 
 
+// 핸드폰 조향: 속도는 저장된 set_speed 를 쓴다
+static void hp_cmd_move(const cmd_args_t *args) {
+  car_angle = args->angle;
+  car_speed = set_speed;
+
+  //Serial.printf("car angle %d and speed %d updated\n", angle, speed);
+  // 서보모터 제어나 다른 장치 제어 코드를 여기 추가할 수 있습니다.
+  if (car_speed != 0) {
+    int lspeed = car_speed + car_angle * 0.5;
+    int rspeed = car_speed - car_angle * 0.5;
+    LOG_D("run Car forward, %d, %d", lspeed, rspeed);
+    motor_forward(lspeed, rspeed);  // I2C 는 모터 태스크가 보낸다
+  }
+}
+
+// 두 엔드포인트 공통
+static void cmd_stop(const cmd_args_t *args) {
+  car_speed = 0;
+  LOG_D("run Car stop");
+  motor_stop();
+}
+
+// /ws 명령 등록 (startCameraServer 에서 한 번)
+void hp_register_commands() {
+  CMD_REGISTER("move", CMD_EP_MASK(CMD_EP_HP), hp_cmd_move);
+  CMD_REGISTER("stop", CMD_EP_MASK(CMD_EP_HP) | CMD_EP_MASK(CMD_EP_PC), cmd_stop);
+}
+
 // WebSocket 핸들러 함수
 esp_err_t ws_handler(httpd_req_t *req) {
   if (req->method == HTTP_GET) {
     // WebSocket 핸들러는 WebSocket 연결을 자동으로 처리
-    Serial.println("WebSocket connection opened");
+    LOG_I("WebSocket connection opened");
     car_angle = set_speed;
+    ws_rx_open(req);  // 이 연결의 수신 버퍼
     return ESP_OK;
   }
 
+  // 세션 버퍼에 프레임 수신 (메시지마다 할당하지 않는다)
   httpd_ws_frame_t ws_pkt;
-  memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-  ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-
-  // 프레임 길이 수신
-  esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
+  esp_err_t ret = ws_rx_recv(req, &ws_pkt);
   if (ret != ESP_OK) {
-    Serial.printf("Failed to receive frame length: %d\n", ret);
     return ret;
   }
 
   // 프레임 페이로드가 있는 경우
   if (ws_pkt.len > 0) {
-    // 페이로드를 저장할 버퍼 할당
-    uint8_t *buf = (uint8_t *)malloc(ws_pkt.len + 1);
-    if (!buf) {
-      Serial.println("Failed to allocate memory for WebSocket payload");
-      return ESP_ERR_NO_MEM;
-    }
-    ws_pkt.payload = buf;
-
-    // 실제 페이로드 수신
-    ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
-    if (ret != ESP_OK) {
-      Serial.printf("Failed to receive frame payload: %d\n", ret);
-      free(buf);
-      return ret;
-    }
-
-    buf[ws_pkt.len] = '\0';  // Null-terminate the payload
+    uint8_t *buf = ws_pkt.payload;
+    blackbox_command(BLACKBOX_SRC_HP, frame_seq, buf, ws_pkt.len);  // 사고 기록용
     //Serial.printf("Received WebSocket message: %s\n", buf);
 
     // 분할된 프레임 처리
     if (!ws_pkt.final) {
-      Serial.println("Received fragmented frame, which is not supported.");
-      free(buf);
+      LOG_W("Received fragmented frame, which is not supported.");
       return ESP_FAIL;  // 또는 적절한 오류 코드
     }
 
+    int64_t start_us = esp_timer_get_time();
+
+    // 바이너리 프레임은 고정 형식 제어 메시지 (control_proto.h)
+    if (ws_pkt.type == HTTPD_WS_TYPE_BINARY) {
+      ctrl_msg_t msg;
+      if (!ctrl_parse(buf, ws_pkt.len, &msg)) {
+        LOG_W("Bad binary control message");
+        ctrl_record_bad();
+        return ESP_FAIL;
+      }
+      ctrl_stats.last_seq = msg.seq;
+      cmd_dispatch_binary(req, CMD_EP_HP, &msg);  // /ws 는 move, stop 만 등록되어 있다
+      ctrl_record(true, start_us);
+      return ESP_OK;
+    }
+
     // JSON 데이터 처리
     StaticJsonDocument<256> jsonDoc;  // StaticJsonDocument을 올바르게 사용
-    DeserializationError error = deserializeJson(jsonDoc, buf);
+    DeserializationError error = deserializeJson(jsonDoc, (char *)buf);  // 버퍼 안에서 바로 파싱 (문자열 복사 없음)
     if (error) {
-      Serial.print("JSON parse error: ");
-      Serial.println(error.c_str());
-      free(buf);
+      LOG_W("JSON parse error: %s", error.c_str());
       return ESP_FAIL;  // 적절한 오류 코드 반환
     }
 
-    //do_ws 헨드폰에서 보내오는 명령어 처리
-    const char *cmd = jsonDoc["cmd"] | "";
-    int angle = jsonDoc["angle"] | 0;
-
-    // 액션 처리
-    if (strcmp(cmd, "move") == 0) {
-
-      car_angle = angle;
-      car_speed = set_speed;
-
-      //Serial.printf("car angle %d and speed %d updated\n", angle, speed);
-      // 서보모터 제어나 다른 장치 제어 코드를 여기 추가할 수 있습니다.
-      if (car_speed != 0) {
-        int lspeed = car_speed + car_angle * 0.5;
-        int rspeed = car_speed - car_angle * 0.5;
-        Serial.printf("run Car forward, %d, %d\n", lspeed, rspeed);
-        Car_forward(lspeed, rspeed);
-      }
-    } else if (strcmp(cmd, "stop") == 0) {
-      car_speed = 0;
-      Serial.printf("run Car stop");
-      Car_stop();
-    } 
+    //do_ws 헨드폰에서 보내오는 명령어 처리 (ctrl_dispatch.h 의 명령 표)
+    cmd_dispatch_json(req, CMD_EP_HP, &jsonDoc);
+    ctrl_record(false, start_us);
     
     // // 클라이언트에 응답 보내기
     // httpd_ws_frame_t ws_res;
@@ -112,10 +121,9 @@ esp_err_t ws_handler(httpd_req_t *req) {
     //   Serial.printf("Failed to send WebSocket frame: %d\n", ret);
     // }
 
-    free(buf);
 
   } else {
-    Serial.println("Received empty WebSocket message");
+    LOG_D("Received empty WebSocket message");
   }
   return ESP_OK;
 }
@@ -7,7 +7,15 @@
 #include <esp_http_server.h>  // esp_http_server.h는 반드시 포함되어야 합니다.
 
 #include <EEPROM.h>
+#include "lwip/sockets.h"
 #include "setMotor.h"
+#include "ws_rx.h"
+#include "frame_share.h"
+#include "blackbox.h"
+#include "ctrl_dispatch.h"
+#include "motor_task.h"
+#include "log_ring.h"
+#include "telemetry.h"
 
 #define LED_BUILTIN 4
 
@@ -16,130 +24,198 @@ int car_angle = 0;  //동작각도
 int car_speed = 0;  // 동작스피드
 int set_speed = 0;  // 셋팅엥글
 
+// stream_sender.h 의 UDP 스트림
+bool stream_udp_start(uint32_t ip, uint16_t port);
+bool stream_udp_stop(uint32_t ip);
+void stream_set_roi(uint32_t ip, int x, int y, int w, int h);
+
+// PC 조향: 속도가 0 이면 정지
+static void pc_cmd_move(const cmd_args_t *args) {
+  car_angle = args->angle;
+  car_speed = args->speed;
+  LOG_D("car angle %d and speed %d updated", car_angle, car_speed);
+
+  // 서보모터 제어나 다른 장치 제어 코드를 여기 추가할 수 있습니다.
+  if (car_speed != 0) {
+    int lspeed = car_speed + car_angle * 0.5;
+    int rspeed = car_speed - car_angle * 0.5;
+    LOG_D("run Car forward, %d, %d", lspeed, rspeed);
+    motor_forward(lspeed, rspeed);  // I2C 는 모터 태스크가 보낸다
+  } else {
+    motor_stop();
+  }
+}
+
+static void pc_cmd_led(const cmd_args_t *args) {
+  if (strcmp(args->state, "on") == 0) {
+    digitalWrite(LED_BUILTIN, HIGH);
+    LOG_I("LED turned on");
+  } else if (strcmp(args->state, "off") == 0) {
+    digitalWrite(LED_BUILTIN, LOW);
+    LOG_I("LED turned off");
+  } else {
+    LOG_W("Unknown state for LED");
+  }
+}
+
+static void pc_cmd_set_speed(const cmd_args_t *args) {
+  set_speed = args->speed;  // PC에서 요청하는 속도값을 전역변수에 저장한다.
+  // EEPROM에 새로운 속도 값을 저장
+  EEPROM.write(0, set_speed);  // EEPROM에 값 기록
+  EEPROM.commit();             // 플래시 메모리에 기록 확정
+  LOG_I("Speed value saved to EEPROM.");
+}
+
+// 바이너리로 물어보면 바이너리로, JSON 으로 물어보면 JSON 으로 답한다
+static void pc_cmd_get_speed(const cmd_args_t *args) {
+  esp_err_t ret;
+  if (args->bin) {
+    ret = ctrl_send_reply(args->req, args->bin, car_angle, car_speed);
+  } else {
+    // 속도 값을 JSON으로 만들어서 클라이언트로 전송
+    StaticJsonDocument<64> responseDoc;
+    responseDoc["car_angle"] = car_angle;  // 전역 변수 set_speed에 저장된 값을 사용
+    responseDoc["car_speed"] = car_speed;  // 전역 변수 set_speed에 저장된 값을 사용
+
+    // JSON을 문자열로 변환
+    char responseBuffer[64];
+    size_t responseSize = serializeJson(responseDoc, responseBuffer);
+
+    // WebSocket을 통해 클라이언트에 전송
+    httpd_ws_frame_t ws_response;
+    memset(&ws_response, 0, sizeof(httpd_ws_frame_t));
+    ws_response.payload = (uint8_t *)responseBuffer;
+    ws_response.len = responseSize;
+    ws_response.type = HTTPD_WS_TYPE_TEXT;
+    ret = httpd_ws_send_frame(args->req, &ws_response);
+  }
+  if (ret != ESP_OK) {
+    LOG_W("Failed to send WebSocket response: %d", ret);
+  }
+}
+
+// {"cmd":"udp_stream","state":"on","port":5005} : 이 WebSocket 을 연 PC 로 UDP JPEG 조각을 보낸다
+// {"cmd":"udp_stream","state":"off"} 은 이 PC 로 가는 스트림만 끝낸다
+static void pc_cmd_udp_stream(const cmd_args_t *args) {
+  struct sockaddr_in peer;
+  socklen_t peer_len = sizeof(peer);
+  if (lwip_getpeername(httpd_req_to_sockfd(args->req), (struct sockaddr *)&peer, &peer_len) != 0) {
+    LOG_W("udp_stream: no peer address");
+    return;
+  }
+  if (strcmp(args->state, "off") == 0) {
+    if (stream_udp_stop(peer.sin_addr.s_addr)) {
+      LOG_I("UDP stream stopped");
+    }
+    return;
+  }
+  int port = args->doc ? (*args->doc)["port"] | 5005 : 5005;
+  if (stream_udp_start(peer.sin_addr.s_addr, htons(port))) {
+    uint32_t ip = peer.sin_addr.s_addr;  // inet_ntoa 버퍼는 로그 태스크가 읽을 때까지 남지 않는다
+    LOG_I("UDP stream to %u.%u.%u.%u:%d", ip & 0xff, (ip >> 8) & 0xff, (ip >> 16) & 0xff, ip >> 24, port);
+  } else {
+    LOG_W("Failed to start UDP stream");
+  }
+}
+
+// {"cmd":"roi","x":0,"y":120,"w":320,"h":120} : 이 PC 의 JPEG 스트림을 사각형만 잘라서 보낸다
+// {"cmd":"roi","state":"off"} 또는 w/h 가 0 이면 전체 화면
+static void pc_cmd_roi(const cmd_args_t *args) {
+  struct sockaddr_in peer;
+  socklen_t peer_len = sizeof(peer);
+  if (!args->doc || lwip_getpeername(httpd_req_to_sockfd(args->req), (struct sockaddr *)&peer, &peer_len) != 0) {
+    return;
+  }
+  JsonDocument &doc = *args->doc;
+  if (strcmp(args->state, "off") == 0) {
+    stream_set_roi(peer.sin_addr.s_addr, 0, 0, 0, 0);
+  } else {
+    stream_set_roi(peer.sin_addr.s_addr, doc["x"] | 0, doc["y"] | 0, doc["w"] | 0, doc["h"] | 0);
+  }
+}
+
+// {"cmd":"telemetry","state":"on","rate":10} : 이 연결로 상태를 rate Hz 로 보낸다 (telemetry.h)
+// 바이너리로 구독하면 (speed = Hz) 바이너리로, JSON 으로 구독하면 JSON 으로 보낸다
+static void pc_cmd_telemetry(const cmd_args_t *args) {
+  httpd_handle_t server = args->req->handle;
+  int fd = httpd_req_to_sockfd(args->req);
+  if (strcmp(args->state, "off") == 0) {
+    telemetry_unsubscribe(server, fd);
+    LOG_I("telemetry: fd %d off", fd);
+    return;
+  }
+  int rate = args->bin ? args->speed : ((*args->doc)["rate"] | TELEMETRY_DEFAULT_HZ);
+  telemetry_subscribe(server, fd, rate, args->bin != NULL);
+}
+
+// /alt_ws 명령 등록 (startCameraServer 에서 한 번). stop 은 jsonContwsHP.h 에서 같이 등록한다.
+void pc_register_commands() {
+  const int pc = CMD_EP_MASK(CMD_EP_PC);
+  CMD_REGISTER("move", pc, pc_cmd_move);
+  CMD_REGISTER("led", pc, pc_cmd_led);
+  CMD_REGISTER("set_speed", pc, pc_cmd_set_speed);
+  CMD_REGISTER("get_speed", pc, pc_cmd_get_speed);
+  CMD_REGISTER("udp_stream", pc, pc_cmd_udp_stream);  // JSON 전용
+  CMD_REGISTER("roi", pc, pc_cmd_roi);                // JSON 전용
+  CMD_REGISTER("telemetry", pc, pc_cmd_telemetry);
+}
 
 // 대체 WebSocket 핸들러 함수 PC
 esp_err_t alt_ws_handler(httpd_req_t *req) {
   if (req->method == HTTP_GET) {
     // WebSocket 핸들러는 WebSocket 연결을 자동으로 처리
-    Serial.println("WebSocket connection opened");
+    LOG_I("WebSocket connection opened");
     car_speed = 0; // 차동차 속도를 초기화 한다. 명령이 들어오면 재설정된다.
+    ws_rx_open(req);  // 이 연결의 수신 버퍼
     return ESP_OK;
   }
 
+  // 세션 버퍼에 프레임 수신 (메시지마다 할당하지 않는다)
   httpd_ws_frame_t ws_pkt;
-  memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-  ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-
-  // 프레임 길이 수신
-  esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
+  esp_err_t ret = ws_rx_recv(req, &ws_pkt);
   if (ret != ESP_OK) {
-    Serial.println("WebSocket connection closed by client or failed to receive frame.");
     return ret;
   }
 
   // 프레임 페이로드가 있는 경우
   if (ws_pkt.len > 0) {
-    // 페이로드를 저장할 버퍼 할당
-    uint8_t *buf = (uint8_t *)malloc(ws_pkt.len + 1);
-    if (!buf) {
-      Serial.println("Failed to allocate memory for WebSocket payload");
-      return ESP_ERR_NO_MEM;
-    }
-    ws_pkt.payload = buf;
-
-    // 실제 페이로드 수신
-    ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
-    if (ret != ESP_OK) {
-      Serial.printf("Failed to receive frame payload: %d\n", ret);
-      free(buf);
-      return ret;
-    }
-
-    buf[ws_pkt.len] = '\0';  // Null-terminate the payload
+    uint8_t *buf = ws_pkt.payload;
+    blackbox_command(BLACKBOX_SRC_PC, frame_seq, buf, ws_pkt.len);  // 사고 기록용
     //Serial.printf("Received WebSocket message: %s\n", buf);
 
     // 분할된 프레임 처리
     if (!ws_pkt.final) {
-      Serial.println("Received fragmented frame, which is not supported.");
-      free(buf);
+      LOG_W("Received fragmented frame, which is not supported.");
       return ESP_FAIL;  // 또는 적절한 오류 코드
     }
 
+    int64_t start_us = esp_timer_get_time();
+
+    // 바이너리 프레임은 고정 형식 제어 메시지, 텍스트 프레임은 JSON
+    if (ws_pkt.type == HTTPD_WS_TYPE_BINARY) {
+      ctrl_msg_t msg;
+      if (!ctrl_parse(buf, ws_pkt.len, &msg)) {
+        LOG_W("Bad binary control message");
+        ctrl_record_bad();
+        return ESP_FAIL;
+      }
+      ctrl_stats.last_seq = msg.seq;
+      cmd_dispatch_binary(req, CMD_EP_PC, &msg);
+      ctrl_record(true, start_us);
+      return ESP_OK;
+    }
+
     // JSON 데이터 처리
     StaticJsonDocument<256> jsonDoc;  // StaticJsonDocument을 올바르게 사용
-    DeserializationError error = deserializeJson(jsonDoc, buf);
+    DeserializationError error = deserializeJson(jsonDoc, (char *)buf);  // 버퍼 안에서 바로 파싱 (문자열 복사 없음)
     if (error) {
-      Serial.print("JSON parse error: ");
-      Serial.println(error.c_str());
-      free(buf);
+      LOG_W("JSON parse error: %s", error.c_str());
       return ESP_FAIL;  // 적절한 오류 코드 반환
     }
 
-    // do_alt PC 에서 사용하는 Commnad
-    // 값 추출 및 기본값 설정 (const char* 사용)
-    const char *cmd = jsonDoc["cmd"] | "";
-    const char *state = jsonDoc["state"] | "";
-    int angle = jsonDoc["angle"] | 0;
-    int speed = jsonDoc["speed"] | 0;
-
-
-    // 액션 처리
-    if (strcmp(cmd, "move") == 0) {
-      car_angle = angle;
-      car_speed = speed;
-      Serial.printf("car angle %d and speed %d updated\n", angle, speed);
-
-      // 서보모터 제어나 다른 장치 제어 코드를 여기 추가할 수 있습니다.
-      if (speed != 0) {
-        int lspeed = car_speed + car_angle * 0.5;
-        int rspeed = car_speed - car_angle * 0.5;
-        Serial.printf("run Car forward, %d, %d", lspeed, rspeed);
-        Car_forward(lspeed, rspeed);
-      } else {
-        Car_stop();
-      }
-    } else if (strcmp(cmd, "led") == 0) {  // 추가된 'led' 액션 처리
-      if (strcmp(state, "on") == 0) {
-        digitalWrite(LED_BUILTIN, HIGH);
-        Serial.println("LED turned on");
-      } else if (strcmp(state, "off") == 0) {
-        digitalWrite(LED_BUILTIN, LOW);
-        Serial.println("LED turned off");
-      } else {
-        Serial.println("Unknown state for LED ");
-      }
-    } else if (strcmp(cmd, "set_speed") == 0) {
-      set_speed = speed;  // PC에서 요청하는 속도값을 전역변수에 저장한다.
-      // EEPROM에 새로운 속도 값을 저장
-      EEPROM.write(0, set_speed);  // EEPROM에 값 기록
-      EEPROM.commit();             // 플래시 메모리에 기록 확정
-      Serial.println("Speed value saved to EEPROM.");
-    }
-
-    else if (strcmp(cmd, "get_speed") == 0) {
-      // 속도 값을 JSON으로 만들어서 클라이언트로 전송
-      StaticJsonDocument<64> responseDoc;
-      responseDoc["car_angle"] = car_angle;  // 전역 변수 set_speed에 저장된 값을 사용
-      responseDoc["car_speed"] = car_speed;  // 전역 변수 set_speed에 저장된 값을 사용
-      
-
-      // JSON을 문자열로 변환
-      char responseBuffer[64];
-      size_t responseSize = serializeJson(responseDoc, responseBuffer);
-
-      // WebSocket을 통해 클라이언트에 전송
-      httpd_ws_frame_t ws_response;
-      memset(&ws_response, 0, sizeof(httpd_ws_frame_t));
-      ws_response.payload = (uint8_t *)responseBuffer;
-      ws_response.len = responseSize;
-      ws_response.type = HTTPD_WS_TYPE_TEXT;
-      ret = httpd_ws_send_frame(req, &ws_response);
-      if (ret != ESP_OK) {
-        Serial.printf("Failed to send WebSocket response: %d\n", ret);
-      } else {
-        //Serial.println("Sent speed value via WebSocket.");
-      }
-    }
+    // do_alt PC 에서 사용하는 Commnad (ctrl_dispatch.h 의 명령 표)
+    cmd_dispatch_json(req, CMD_EP_PC, &jsonDoc);
+    ctrl_record(false, start_us);
 
     // 클라이언트에 응답 보내기
     // httpd_ws_frame_t ws_res;
@@ -155,9 +231,8 @@ esp_err_t alt_ws_handler(httpd_req_t *req) {
     //   Serial.printf("Failed to send WebSocket frame: %d\n", ret);
     // }
 
-    free(buf);
   } else {
-    Serial.println("Received empty WebSocket message");
+    LOG_D("Received empty WebSocket message");
   }
   return ESP_OK;
 
@@ -0,0 +1,184 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "task_topology.h"
+#include "stream_stats.h"
+
+// 비동기 로그. 115200 baud 에서 Serial.printf 한 줄은 1 ms 넘게 블록될 수 있으므로
+// 제어/스트림 경로에서는 형식 문자열 주소와 인자만 링에 넣고 (LOG_E/W/I/D),
+// 낮은 우선순위의 로그 태스크가 나중에 snprintf 해서 Serial 로 내보낸다.
+//
+//   - 형식 문자열은 리터럴이어야 한다 (주소만 저장한다). 줄 끝 \n 은 붙이지 않는다.
+//   - 인자는 LOG_MAX_ARGS 개까지, 정수 또는 수명이 긴 문자열 (리터럴, 세션 이름 등) 만 쓴다.
+//     포인터 크기 (uintptr_t) 로 저장해 그대로 snprintf 에 넘긴다. ESP32 에서는 int 와 같은 32 비트다.
+//     float 는 넣을 수 없으므로 정수로 바꿔서 넣는다.
+//   - LOG_LEVEL 보다 자세한 로그는 매크로가 비어 있어 호출과 문자열이 모두 빠진다.
+//   - 링이 가득 차면 새 이벤트를 버리고 dropped 로 센다 (로그 태스크가 주기적으로 알린다).
+//
+// 링은 칸마다 순번을 두는 다중 생산자 / 단일 소비자 큐라서 쓰는 쪽은 CAS 한 번으로 칸을 잡는다 (락 없음).
+// 부팅/초기화 메시지처럼 한 번만 나오는 로그는 지금처럼 Serial 을 바로 쓴다.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_SLOTS 128          // 2 의 거듭제곱
+#define LOG_MAX_ARGS 6
+#define LOG_LINE_MAX 160
+#define LOG_DRAIN_MS 20        // 링이 비었을 때 로그 태스크가 쉬는 시간
+#define LOG_TASK_STACK 3072
+#define LOG_COST_SAMPLES 16    // 호출 비용 표본 (64 번에 한 번)
+
+typedef struct {
+    uint32_t seq;              // 칸 순번 (비었으면 pos, 차 있으면 pos + 1)
+    const char *fmt;
+    uint32_t ms;               // 부팅 후 ms
+    uint8_t level;
+    uint8_t argc;
+    uintptr_t args[LOG_MAX_ARGS];
+} log_event_t;
+
+static log_event_t log_ring[LOG_SLOTS];
+static uint32_t log_head;      // 다음에 쓸 위치 (생산자들이 CAS)
+static uint32_t log_tail;      // 다음에 읽을 위치 (로그 태스크만)
+static uint32_t log_written;
+static uint32_t log_dropped;
+static uint32_t log_cost_cycles[LOG_COST_SAMPLES];
+
+void log_init() {
+    for (uint32_t i = 0; i < LOG_SLOTS; i++) {
+        log_ring[i].seq = i;
+    }
+    log_head = 0;
+    log_tail = 0;
+}
+
+static inline uintptr_t log_arg(int v) { return (uintptr_t)v; }
+static inline uintptr_t log_arg(unsigned v) { return v; }
+static inline uintptr_t log_arg(long v) { return (uintptr_t)v; }
+static inline uintptr_t log_arg(unsigned long v) { return (uintptr_t)v; }
+static inline uintptr_t log_arg(const char *v) { return (uintptr_t)v; }
+
+template <typename... A>
+void log_write(uint8_t level, const char *fmt, A... args) {
+    static_assert(sizeof...(A) <= LOG_MAX_ARGS, "too many log arguments");
+    uint32_t start = ESP.getCycleCount();
+    uint32_t pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+    log_event_t *e;
+    while (true) {
+        e = &log_ring[pos & (LOG_SLOTS - 1)];
+        int32_t dif = (int32_t)(__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&log_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            __atomic_add_fetch(&log_dropped, 1, __ATOMIC_RELAXED);  // 가득 참
+            return;
+        } else {
+            pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+        }
+    }
+    uintptr_t vals[sizeof...(A) + 1] = { log_arg(args)... };
+    e->fmt = fmt;
+    e->ms = esp_timer_get_time() / 1000;
+    e->level = level;
+    e->argc = sizeof...(A);
+    memcpy(e->args, vals, sizeof...(A) * sizeof(uintptr_t));
+    __atomic_store_n(&e->seq, pos + 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&log_written, 1, __ATOMIC_RELAXED);
+    if ((pos & 63) == 0) {
+        log_cost_cycles[(pos / 64) % LOG_COST_SAMPLES] = ESP.getCycleCount() - start;
+    }
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(fmt, ...) log_write(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_E(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(fmt, ...) log_write(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(fmt, ...) log_write(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(fmt, ...) log_write(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...) do {} while (0)
+#endif
+
+// 링에서 하나를 꺼내 한 줄로 만든다. 비었으면 false.
+static bool log_pop_line(char *line, size_t len) {
+    log_event_t *e = &log_ring[log_tail & (LOG_SLOTS - 1)];
+    if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != log_tail + 1) {
+        return false;
+    }
+    static const char levels[] = "-EWID";
+    int n = snprintf(line, len, "%5u.%03u %c ", (unsigned)(e->ms / 1000), (unsigned)(e->ms % 1000),
+                     levels[e->level < sizeof(levels) - 1 ? e->level : 0]);
+    uintptr_t *a = e->args;
+    n += snprintf(line + n, len - n - 1, e->fmt, a[0], a[1], a[2], a[3], a[4], a[5]);
+    if (n > (int)len - 2) {
+        n = len - 2;
+    }
+    line[n] = '\n';
+    line[n + 1] = '\0';
+    __atomic_store_n(&e->seq, log_tail + LOG_SLOTS, __ATOMIC_RELEASE);
+    log_tail++;
+    return true;
+}
+
+static void log_task(void *param) {
+    char line[LOG_LINE_MAX];
+    uint32_t reported = 0;
+    while (true) {
+        while (log_pop_line(line, sizeof(line))) {
+            Serial.print(line);
+        }
+        uint32_t dropped = __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+        if (dropped != reported) {
+            Serial.printf("log: %u events dropped\n", (unsigned)(dropped - reported));
+            reported = dropped;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
+
+// 첫 LOG_x 보다 먼저 부른다 (startCameraServer 맨 앞)
+void log_task_init() {
+    log_init();
+    task_create(log_task, "log", LOG_TASK_STACK, NULL, TASK_PRIO_LOG, TASK_CORE_LOG, NULL);
+}
+
+// /stats 용 JSON
+int log_stats_json(char *buf, size_t len) {
+    uint32_t sum = 0;
+    int samples = 0;
+    for (int i = 0; i < LOG_COST_SAMPLES; i++) {
+        if (log_cost_cycles[i]) {
+            sum += log_cost_cycles[i];
+            samples++;
+        }
+    }
+    int n = snprintf(buf, len, "{\"level\":%d,\"written\":%u,\"dropped\":%u,\"pending\":%u,\"call_cycles\":%u}",
+                     LOG_LEVEL, (unsigned)log_written, (unsigned)log_dropped,
+                     (unsigned)(__atomic_load_n(&log_head, __ATOMIC_RELAXED) - log_tail),
+                     samples ? (unsigned)(sum / samples) : 0);
+    return stats_json_fit(n, len);
+}
+
+#endif  // LOG_RING_H
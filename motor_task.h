@@ -0,0 +1,106 @@
+#ifndef MOTOR_TASK_H
+#define MOTOR_TASK_H
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include "setMotor.h"
+#include "stream_stats.h"
+#include "task_topology.h"
+
+// 모터 제어 우편함. Car_forward()/Car_stop() 은 I2C 쓰기를 네 번 하므로 (블록됨)
+// WebSocket 핸들러 (httpd 태스크) 는 목표값만 우편함에 넣고 바로 돌아간다.
+// 모터 태스크가 MOTOR_RATE_HZ 로 돌면서 가장 최근 값 하나만 I2C 로 보내므로
+// 그 사이에 들어온 오래된 명령은 버려진다 (dropped).
+//
+// 우편함은 32 비트 한 칸이라서 원자적 교환 한 번으로 넣고 꺼낸다 (락 없음).
+//   [seq 8][kind 8][left 8][right 8]   kind 0 = 비어 있음
+// 넣은 시각은 seq 로 찾는 motor_post_us[] 에 먼저 써두고 꺼낸 쪽이 I2C 를 마친 뒤
+// 명령 -> 구동 지연을 잰다.
+
+#define MOTOR_RATE_HZ 100
+#define MOTOR_TASK_STACK 3072
+
+#define MOTOR_CMD_FORWARD 1
+#define MOTOR_CMD_STOP 2
+
+typedef struct {
+    uint32_t posted;          // 넣은 명령 수
+    uint32_t applied;         // 모터에 보낸 명령 수
+    uint32_t dropped;         // 모터에 보내기 전에 새 명령으로 덮인 수
+    stats_hist_t latency_us;  // 넣은 시각 -> I2C 쓰기 끝
+    stats_hist_t i2c_us;      // I2C 쓰기에 걸린 시간
+} motor_stats_t;
+
+static motor_stats_t motor_stats;
+static uint32_t motor_mailbox;     // 0 = 비어 있음
+static uint32_t motor_seq;
+static int64_t motor_post_us[256]; // seq (8 비트) 별 넣은 시각
+
+static void motor_post(uint8_t kind, uint8_t left, uint8_t right) {
+    uint8_t seq = __atomic_fetch_add(&motor_seq, 1, __ATOMIC_RELAXED);
+    motor_post_us[seq] = esp_timer_get_time();
+    uint32_t cmd = (uint32_t)seq << 24 | (uint32_t)kind << 16 | (uint32_t)left << 8 | right;
+    uint32_t old = __atomic_exchange_n(&motor_mailbox, cmd, __ATOMIC_ACQ_REL);
+    __atomic_add_fetch(&motor_stats.posted, 1, __ATOMIC_RELAXED);
+    if (old != 0) {
+        __atomic_add_fetch(&motor_stats.dropped, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// 핸들러에서 Car_forward() 대신 부른다
+void motor_forward(uint8_t left, uint8_t right) {
+    motor_post(MOTOR_CMD_FORWARD, left, right);
+}
+
+// 핸들러에서 Car_stop() 대신 부른다
+void motor_stop() {
+    motor_post(MOTOR_CMD_STOP, 0, 0);
+}
+
+static void motor_task(void *param) {
+    TickType_t last_wake = xTaskGetTickCount();
+    TickType_t period = pdMS_TO_TICKS(1000 / MOTOR_RATE_HZ);
+    if (period == 0) {
+        period = 1;
+    }
+    while (true) {
+        vTaskDelayUntil(&last_wake, period);
+        uint32_t cmd = __atomic_exchange_n(&motor_mailbox, 0, __ATOMIC_ACQ_REL);
+        if (cmd == 0) {
+            continue;
+        }
+        int64_t start_us = esp_timer_get_time();
+        if (((cmd >> 16) & 0xFF) == MOTOR_CMD_STOP) {
+            Car_stop();
+        } else {
+            Car_forward((cmd >> 8) & 0xFF, cmd & 0xFF);
+        }
+        int64_t now = esp_timer_get_time();
+        motor_stats.applied++;
+        stats_hist_add(&motor_stats.i2c_us, now - start_us, 0);
+        stats_hist_add(&motor_stats.latency_us, now - motor_post_us[cmd >> 24], 0);
+        task_busy_add(now - start_us);
+    }
+}
+
+void motor_task_init() {
+    memset(&motor_stats, 0, sizeof(motor_stats));
+    stats_hist_reset(&motor_stats.latency_us);
+    stats_hist_reset(&motor_stats.i2c_us);
+    task_create(motor_task, "motor", MOTOR_TASK_STACK, NULL, TASK_PRIO_MOTOR, TASK_CORE_MOTOR, NULL);
+}
+
+// /stats 용 JSON
+int motor_stats_json(char *buf, size_t len) {
+    int n = snprintf(buf, len, "{\"rate_hz\":%d,\"posted\":%u,\"applied\":%u,\"dropped\":%u,\"latency_us\":",
+                     MOTOR_RATE_HZ, (unsigned)motor_stats.posted, (unsigned)motor_stats.applied,
+                     (unsigned)motor_stats.dropped);
+    n = stats_json_fit(n, len);
+    n += stats_summary_json(buf + n, len - n, &motor_stats.latency_us);
+    n += stats_json_fit(snprintf(buf + n, len - n, ",\"i2c_us\":"), len - n);
+    n += stats_summary_json(buf + n, len - n, &motor_stats.i2c_us);
+    n += stats_json_fit(snprintf(buf + n, len - n, "}"), len - n);
+    return n;
+}
+
+#endif  // MOTOR_TASK_H
@@ -0,0 +1,279 @@
+#ifndef UDP_JPEG_RECEIVER_H
+#define UDP_JPEG_RECEIVER_H
+
+// PC 쪽 UDP JPEG 조각 수신기 (POSIX 소켓, 헤더만으로 사용).
+// 차의 /alt_ws 에 {"cmd":"udp_stream","state":"on","port":5005} 를 보낸 뒤
+//
+//   udp_jpeg::Receiver rx;
+//   rx.open(5005);
+//   udp_jpeg::Frame f;
+//   while (rx.receive(&f, 1000)) { decode(f.data, f.size); }
+//
+// 조각은 헤더만 MSG_PEEK 로 먼저 읽고, 데이터는 recvmsg 로 프레임 버퍼의
+// 제자리 (frag_index * UDP_FRAG_PAYLOAD) 에 바로 받는다. 따로 복사하지 않는다.
+// 더 새로운 프레임이 완성되면 그보다 오래된 미완성 프레임은 기다리지 않고 버린다.
+//
+// 차가 다시 켜지면 프레임 번호가 1 부터 다시 시작한다. 마지막으로 완성한 번호보다
+// UDP_RESYNC_GAP 넘게 뒤로 간 조각이 오거나, resync_ms 동안 프레임을 하나도 완성하지 못한 채
+// 지난 번호의 조각만 오면 새 스트림으로 보고 처음부터 다시 받는다 (stats().resyncs).
+
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <chrono>
+#include <vector>
+
+#include "../udp_frame_proto.h"
+
+namespace udp_jpeg {
+
+// 이보다 많이 뒤로 간 프레임 번호는 늦게 온 조각이 아니라 새 스트림이다
+const uint32_t UDP_RESYNC_GAP = 64;
+
+struct Frame {
+    uint32_t id;             // 차의 프레임 번호
+    uint64_t timestamp_us;   // 차의 캡처 시각 (차의 시계)
+    const uint8_t *data;     // 다음 receive() 호출 전까지 유효
+    size_t size;
+};
+
+struct Stats {
+    uint64_t packets = 0;          // 받은 데이터그램
+    uint64_t bad_packets = 0;      // 형식이 맞지 않는 데이터그램
+    uint64_t late_packets = 0;     // 이미 넘긴 프레임의 조각
+    uint64_t frames = 0;           // 완성된 프레임
+    uint64_t incomplete = 0;       // 조각이 빠져서 버린 프레임
+    uint64_t resyncs = 0;          // 프레임 번호가 처음부터 다시 시작해서 새로 맞춘 횟수
+};
+
+class Receiver {
+public:
+    // slots: 동시에 조립할 수 있는 프레임 수, max_frame: JPEG 최대 크기,
+    // resync_ms: 프레임을 완성하지 못한 채 지난 번호만 오면 새 스트림으로 보는 시간
+    explicit Receiver(int slots = 4, size_t max_frame = 512 * 1024, int resync_ms = 1000)
+        : slots_(slots), resync_(std::chrono::milliseconds(resync_ms)) {
+        for (Slot &s : slots_) {
+            s.buf.resize(max_frame);
+            s.have.resize((max_frame + UDP_FRAG_PAYLOAD - 1) / UDP_FRAG_PAYLOAD);
+        }
+    }
+
+    ~Receiver() { close(); }
+
+    Receiver(const Receiver &) = delete;
+    Receiver &operator=(const Receiver &) = delete;
+
+    bool open(uint16_t port, const char *bind_addr = nullptr, int rcvbuf = 1 << 20) {
+        close();
+        fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0) {
+            return false;
+        }
+        // 버스트로 오는 조각을 놓치지 않도록 수신 버퍼를 키운다
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = bind_addr ? inet_addr(bind_addr) : htonl(INADDR_ANY);
+        if (::bind(fd_, (sockaddr *)&addr, sizeof(addr)) < 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    int fd() const { return fd_; }
+    const Stats &stats() const { return stats_; }
+
+    // 프레임이 완성될 때까지 최대 timeout_ms 동안 받는다. 시간 안에 없으면 false.
+    // 이전에 돌려준 프레임의 버퍼는 이 호출에서 다시 쓰일 수 있다.
+    bool receive(Frame *out, int timeout_ms) {
+        if (fd_ < 0) {
+            return false;
+        }
+        if (held_) {
+            held_->active = false;
+            held_ = nullptr;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (true) {
+            int wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                              deadline - std::chrono::steady_clock::now()).count();
+            pollfd pfd = { fd_, POLLIN, 0 };
+            if (::poll(&pfd, 1, wait_ms > 0 ? wait_ms : 0) <= 0) {
+                return false;
+            }
+            Slot *done = read_packet();
+            if (done) {
+                complete(done, out);
+                return true;
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        bool active = false;
+        uint32_t id = 0;
+        uint16_t frag_count = 0;
+        uint16_t got = 0;
+        uint32_t len = 0;
+        uint64_t timestamp_us = 0;
+        std::vector<uint8_t> have;  // 조각별 수신 여부
+        std::vector<uint8_t> buf;
+    };
+
+    static bool newer(uint32_t a, uint32_t b) { return (int32_t)(a - b) > 0; }
+
+    // 마지막으로 완성한 프레임보다 오래된 번호의 조각인가. 새 스트림으로 보이면 상태를 비우고 false.
+    bool stale(uint32_t id) {
+        if (!have_last_ || newer(id, last_id_)) {
+            return false;
+        }
+        if (last_id_ - id <= UDP_RESYNC_GAP && std::chrono::steady_clock::now() - last_frame_at_ < resync_) {
+            return true;
+        }
+        for (Slot &s : slots_) {
+            s.active = false;
+        }
+        have_last_ = false;
+        stats_.resyncs++;
+        return false;
+    }
+
+    // 데이터그램을 헤더만 읽고 버린다 (UDP 는 남은 부분이 잘려 나간다)
+    void discard() {
+        udp_frag_hdr_t hdr;
+        ::recv(fd_, &hdr, sizeof(hdr), MSG_DONTWAIT);
+    }
+
+    bool valid(const udp_frag_hdr_t &h) const {
+        return h.magic == UDP_FRAG_MAGIC && h.version == UDP_FRAG_VERSION && h.frag_count > 0 &&
+               h.frag_index < h.frag_count && h.frame_len <= slots_[0].buf.size() &&
+               h.frag_count == (h.frame_len + UDP_FRAG_PAYLOAD - 1) / UDP_FRAG_PAYLOAD;
+    }
+
+    // 이 프레임을 조립할 슬롯. 없으면 빈 슬롯을, 그것도 없으면 가장 오래된 미완성 프레임을 버리고 쓴다.
+    Slot *slot_for(const udp_frag_hdr_t &h) {
+        Slot *oldest = nullptr;
+        for (Slot &s : slots_) {
+            if (s.active && s.id == h.frame_id) {
+                return &s;
+            }
+        }
+        for (Slot &s : slots_) {
+            if (!s.active) {
+                oldest = &s;
+                break;
+            }
+            if (!oldest || newer(oldest->id, s.id)) {
+                oldest = &s;
+            }
+        }
+        if (oldest->active) {
+            if (newer(oldest->id, h.frame_id)) {
+                return nullptr;  // 조립 중인 프레임보다 더 오래된 조각
+            }
+            stats_.incomplete++;
+        }
+        oldest->active = true;
+        oldest->id = h.frame_id;
+        oldest->frag_count = h.frag_count;
+        oldest->got = 0;
+        oldest->len = h.frame_len;
+        oldest->timestamp_us = h.timestamp_us;
+        memset(oldest->have.data(), 0, h.frag_count);
+        return oldest;
+    }
+
+    // 데이터그램 하나를 받는다. 이것으로 프레임이 완성되면 그 슬롯을 돌려준다.
+    Slot *read_packet() {
+        udp_frag_hdr_t hdr;
+        ssize_t n = ::recv(fd_, &hdr, sizeof(hdr), MSG_PEEK | MSG_DONTWAIT);
+        if (n < 0) {
+            return nullptr;
+        }
+        stats_.packets++;
+        if (n < (ssize_t)sizeof(hdr) || !valid(hdr)) {
+            stats_.bad_packets++;
+            discard();
+            return nullptr;
+        }
+        Slot *s = stale(hdr.frame_id) ? nullptr : slot_for(hdr);
+        if (s && (hdr.frame_len != s->len || hdr.frag_count != s->frag_count)) {
+            // 같은 번호인데 길이가 다르다 (위조되었거나 다른 송신자). 슬롯 범위를 넘어 쓰지 않게 버린다.
+            stats_.bad_packets++;
+            discard();
+            return nullptr;
+        }
+        if (!s || s->have[hdr.frag_index]) {
+            stats_.late_packets++;
+            discard();
+            return nullptr;
+        }
+
+        size_t off = (size_t)hdr.frag_index * UDP_FRAG_PAYLOAD;
+        size_t want = s->len - off < (size_t)UDP_FRAG_PAYLOAD ? s->len - off : (size_t)UDP_FRAG_PAYLOAD;
+        assert(off < s->len && off + want <= s->buf.size());
+        iovec iov[2];
+        iov[0] = { &hdr, sizeof(hdr) };
+        iov[1] = { s->buf.data() + off, want };
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        n = ::recvmsg(fd_, &msg, MSG_DONTWAIT);
+        if (n != (ssize_t)(sizeof(hdr) + want) || (msg.msg_flags & MSG_TRUNC)) {
+            stats_.bad_packets++;
+            return nullptr;
+        }
+        s->have[hdr.frag_index] = 1;
+        return ++s->got == s->frag_count ? s : nullptr;
+    }
+
+    // 완성된 프레임을 넘기고 그보다 오래된 미완성 프레임은 버린다
+    void complete(Slot *s, Frame *out) {
+        for (Slot &o : slots_) {
+            if (o.active && &o != s && newer(s->id, o.id)) {
+                o.active = false;
+                stats_.incomplete++;
+            }
+        }
+        stats_.frames++;
+        last_id_ = s->id;
+        last_frame_at_ = std::chrono::steady_clock::now();
+        have_last_ = true;
+        held_ = s;
+        out->id = s->id;
+        out->timestamp_us = s->timestamp_us;
+        out->data = s->buf.data();
+        out->size = s->len;
+    }
+
+    int fd_ = -1;
+    std::vector<Slot> slots_;
+    Slot *held_ = nullptr;
+    uint32_t last_id_ = 0;
+    bool have_last_ = false;
+    std::chrono::steady_clock::time_point last_frame_at_;
+    std::chrono::steady_clock::duration resync_;
+    Stats stats_;
+};
+
+}  // namespace udp_jpeg
+
+#endif  // UDP_JPEG_RECEIVER_H
@@ -0,0 +1,155 @@
+#ifndef ROI_CROP_H
+#define ROI_CROP_H
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "esp_jpg_decode.h"
+#include "img_converters.h"
+#include "tensor_prep.h"
+
+// 관심 영역 (ROI) 잘라내기. PC 의 차선 모델은 화면 아래쪽만 쓰므로
+// 클라이언트마다 정한 사각형만 다시 JPEG 으로 만들어 보낸다 (/alt_ws 의 roi 명령).
+// 센서 윈도잉은 모든 클라이언트에 한꺼번에 걸리므로 쓰지 않고 디코드 -> 자르기 -> 인코드 한다.
+//
+// 디코더는 블록 (MCU, OV2640 은 16x8) 단위로 RGB888 을 넘겨준다.
+//   - 인코더 (fmt2jpg, PIXFORMAT_RGB888) 는 화소를 B, G, R 순서로 읽으므로 복사하면서 R 과 B 를 바꾼다.
+//   - ROI 를 MCU 경계에 맞추면 (ROI_SNAP_MCU) 블록은 통째로 안이거나 밖이므로 블록 안에서만 자른다.
+//   - ROI 의 마지막 행을 지나면 디코딩을 멈춘다 (아래쪽을 버리는 ROI 는 디코드 시간도 준다).
+
+#define ROI_MCU 16
+#define ROI_SNAP_MCU 1
+#define ROI_JPEG_QUALITY 80   // fmt2jpg 품질 (0~100, 클수록 좋음)
+
+typedef struct {
+    uint16_t x, y, w, h;      // w == 0 이면 ROI 없음
+} roi_rect_t;
+
+// 요청을 원자적으로 넘기기 위해 64 비트 하나로 묶는다 (0 = 없음)
+static inline uint64_t roi_pack(const roi_rect_t *r) {
+    return r->w == 0 ? 0 : (uint64_t)r->x | (uint64_t)r->y << 16 | (uint64_t)r->w << 32 | (uint64_t)r->h << 48;
+}
+
+static inline roi_rect_t roi_unpack(uint64_t v) {
+    roi_rect_t r = { (uint16_t)v, (uint16_t)(v >> 16), (uint16_t)(v >> 32), (uint16_t)(v >> 48) };
+    return r;
+}
+
+// ROI 를 MCU 격자에 맞춰 바깥쪽으로 넓힌다
+static inline void roi_snap(roi_rect_t *r) {
+    uint16_t x1 = (r->x + r->w + ROI_MCU - 1) / ROI_MCU * ROI_MCU;
+    uint16_t y1 = (r->y + r->h + ROI_MCU - 1) / ROI_MCU * ROI_MCU;
+    r->x = r->x / ROI_MCU * ROI_MCU;
+    r->y = r->y / ROI_MCU * ROI_MCU;
+    r->w = x1 - r->x;
+    r->h = y1 - r->y;
+}
+
+// from_w x from_h 프레임 기준의 ROI 를 to_w x to_h 프레임 기준으로 바꾼다 (적응 제어로 해상도가 바뀔 때)
+static inline roi_rect_t roi_scale(roi_rect_t r, int from_w, int from_h, int to_w, int to_h) {
+    roi_rect_t s;
+    s.x = r.x * to_w / from_w;
+    s.y = r.y * to_h / from_h;
+    s.w = max(1, r.w * to_w / from_w);
+    s.h = max(1, r.h * to_h / from_h);
+    if (ROI_SNAP_MCU) {
+        roi_snap(&s);
+    }
+    return s;
+}
+
+typedef struct {
+    const uint8_t *jpg;
+    size_t jpg_len;
+    roi_rect_t roi;           // 프레임 안으로 잘린 ROI
+    uint8_t *rgb;             // roi.w x roi.h x 3 (BGR, fmt2jpg 의 RGB888 순서)
+    bool done;                // ROI 의 마지막 행까지 받음 (디코딩을 일찍 멈춤)
+    uint8_t *out;             // 인코딩 결과
+    size_t out_cap;
+    size_t out_len;
+} roi_job_t;
+
+static size_t roi_jpg_read(void *arg, size_t index, uint8_t *buf, size_t len) {
+    roi_job_t *job = (roi_job_t *)arg;
+    if (index + len > job->jpg_len) {
+        len = job->jpg_len - index;
+    }
+    if (buf) {
+        memcpy(buf, job->jpg + index, len);
+    }
+    return len;
+}
+
+static bool roi_jpg_write(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data) {
+    roi_job_t *job = (roi_job_t *)arg;
+    const roi_rect_t *r = &job->roi;
+
+    if (!data) {
+        return true;  // 시작/끝 알림
+    }
+    if (y >= r->y + r->h) {
+        job->done = true;
+        return false;  // ROI 아래쪽은 디코딩하지 않는다
+    }
+    int x0 = max((int)x, (int)r->x);
+    int x1 = min((int)(x + w), (int)(r->x + r->w));
+    int y0 = max((int)y, (int)r->y);
+    int y1 = min((int)(y + h), (int)(r->y + r->h));
+    if (x0 >= x1 || y0 >= y1) {
+        return true;  // 블록이 ROI 밖
+    }
+    for (int sy = y0; sy < y1; sy++) {
+        uint8_t *dst = job->rgb + ((sy - r->y) * r->w + (x0 - r->x)) * 3;
+        const uint8_t *src = data + ((sy - y) * w + (x0 - x)) * 3;
+        for (int i = 0; i < x1 - x0; i++, dst += 3, src += 3) {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+        }
+    }
+    return true;
+}
+
+static size_t roi_jpg_out(void *arg, size_t index, const void *data, size_t len) {
+    roi_job_t *job = (roi_job_t *)arg;
+    if (index + len > job->out_cap) {
+        return 0;  // 출력 버퍼가 모자라다
+    }
+    memcpy(job->out + index, data, len);
+    job->out_len = index + len;
+    return len;
+}
+
+// fb 에서 roi 를 잘라 out 에 JPEG 으로 만든다. rgb 는 roi.w * roi.h * 3 바이트.
+// roi 가 프레임 밖으로 나가면 프레임 안으로 줄인다. 성공하면 JPEG 길이, 실패하면 0.
+size_t roi_crop_jpeg(const camera_fb_t *fb, roi_rect_t roi, uint8_t *rgb, uint8_t *out, size_t out_cap) {
+    if (roi.x >= fb->width || roi.y >= fb->height) {
+        return 0;
+    }
+    roi.w = min((int)roi.w, (int)fb->width - roi.x);
+    roi.h = min((int)roi.h, (int)fb->height - roi.y);
+
+    roi_job_t job;
+    job.jpg = fb->buf;
+    job.jpg_len = fb->len;
+    job.roi = roi;
+    job.rgb = rgb;
+    job.done = false;
+    job.out = out;
+    job.out_cap = out_cap;
+    job.out_len = 0;
+
+    // esp_jpg_decode 는 텐서 변환과 같은 작업 영역을 쓴다
+    xSemaphoreTake(tensor_lock, portMAX_DELAY);
+    esp_err_t err = esp_jpg_decode(fb->len, JPG_SCALE_NONE, roi_jpg_read, roi_jpg_write, &job);
+    xSemaphoreGive(tensor_lock);
+    if (err != ESP_OK && !job.done) {
+        return 0;
+    }
+
+    if (!fmt2jpg_cb(rgb, roi.w * roi.h * 3, roi.w, roi.h, PIXFORMAT_RGB888, ROI_JPEG_QUALITY, roi_jpg_out, &job)) {
+        return 0;
+    }
+    return job.out_len;
+}
+
+#endif  // ROI_CROP_H
@@ -0,0 +1,75 @@
+#ifndef STILL_FRAME_H
+#define STILL_FRAME_H
+
+#include "Arduino.h"
+#include "esp_camera.h"
+
+// 정지 화면 감지. 차가 서 있으면 거의 같은 프레임을 계속 보내게 되므로
+// 캡처 태스크에서 싸게 변화를 판단하고, 스트림은 바뀌지 않은 프레임을
+// STILL_KEEPALIVE_US 에 한 장만 보낸다 (stream_sender.h).
+//
+// JPEG 은 한 픽셀만 바뀌어도 그 뒤의 바이트가 모두 밀리므로 전체 비교 대신 두 가지를 모두 본다.
+//   - 크기가 기준 프레임과 STILL_SIZE_TOLERANCE 이내 (싸게 먼저 거른다)
+//   - 기준 프레임 길이로 정한 STILL_SAMPLES 곳의 바이트 중 다른 곳이 STILL_SAMPLE_DIFF 이하
+// 크기만 보면 크기가 비슷한 다른 장면 (차가 지나가는 장면 등) 을 정지 화면으로 잘못 보고 숨긴다.
+// 반대로 노이즈 때문에 바이트가 일찍 갈라지면 바뀐 프레임으로 보는데, 이때는 그냥 보내므로 안전하다.
+// 기준 프레임은 마지막으로 "바뀐" 프레임이므로 천천히 변하는 장면도 차이가 쌓이면 바뀐 것으로 잡힌다.
+// 비슷한 프레임이 STILL_MIN_FRAMES 번 이어져야 정지 화면으로 보므로 움직이기 시작하면 바로 풀린다.
+// 기준값은 test/host/test_still.cpp 의 프레임 기록으로 확인한다.
+
+#define STILL_SUPPRESS 1
+#define STILL_SIZE_TOLERANCE 0.01f
+#define STILL_MIN_FRAMES 5
+#define STILL_KEEPALIVE_US 1000000
+#define STILL_SAMPLES 64
+#define STILL_SAMPLE_DIFF 8
+
+typedef struct {
+    uint32_t ref_len;                     // 기준 프레임 크기 (0 이면 없음)
+    uint8_t ref_samples[STILL_SAMPLES];   // 기준 프레임의 샘플 바이트
+    int similar;                          // 기준 프레임과 비슷한 연속 프레임 수
+    uint32_t still;                       // 정지 화면으로 판단한 프레임 수
+} still_state_t;
+
+static still_state_t still_state;  // 캡처 태스크만 쓴다
+
+void still_reset() {
+    memset(&still_state, 0, sizeof(still_state));
+}
+
+// 샘플 i 의 위치. 기준 프레임 길이로 정하므로 앞부분이 같은 프레임은 같은 바이트를 비교한다.
+static inline size_t still_sample_pos(uint32_t ref_len, int i) {
+    return (size_t)i * ref_len / STILL_SAMPLES;
+}
+
+// 기준 프레임과 다른 샘플 수 (프레임이 짧아서 없는 위치도 다른 것으로 센다)
+static int still_sample_diff(const uint8_t *buf, size_t len) {
+    int diff = 0;
+    for (int i = 0; i < STILL_SAMPLES; i++) {
+        size_t pos = still_sample_pos(still_state.ref_len, i);
+        diff += pos >= len || buf[pos] != still_state.ref_samples[i];
+    }
+    return diff;
+}
+
+// 이 프레임이 정지 화면이면 true. 캡처 태스크에서만 호출한다.
+bool still_detect(const camera_fb_t *fb) {
+    uint32_t size_diff = fb->len > still_state.ref_len ? fb->len - still_state.ref_len : still_state.ref_len - fb->len;
+    bool similar = still_state.ref_len != 0 && size_diff <= still_state.ref_len * STILL_SIZE_TOLERANCE &&
+                   still_sample_diff(fb->buf, fb->len) <= STILL_SAMPLE_DIFF;
+    if (!similar) {
+        still_state.ref_len = fb->len;
+        for (int i = 0; i < STILL_SAMPLES; i++) {
+            still_state.ref_samples[i] = fb->buf[still_sample_pos(fb->len, i)];
+        }
+        still_state.similar = 0;
+        return false;
+    }
+    if (++still_state.similar < STILL_MIN_FRAMES) {
+        return false;
+    }
+    still_state.still++;
+    return true;
+}
+
+#endif  // STILL_FRAME_H
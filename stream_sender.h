@@ -0,0 +1,961 @@
+#ifndef STREAM_SENDER_H
+#define STREAM_SENDER_H
+
+#include <errno.h>
+#include <unistd.h>
+#include "Arduino.h"
+#include "esp_http_server.h"
+#include "lwip/sockets.h"
+#include "esp_timer.h"
+#include "frame_share.h"
+#include "stream_stats.h"
+#include "adaptive_quality.h"
+#include "tensor_prep.h"
+#include "udp_frame_proto.h"
+#include "block_pool.h"
+#include "task_topology.h"
+#include "still_frame.h"
+#include "roi_crop.h"
+#include "log_ring.h"
+#include "telemetry.h"
+
+// MJPEG 스트림 세션을 httpd 태스크 밖의 전송 태스크에서 보낸다.
+// 스트림 핸들러는 응답 헤더만 보내고 세션을 큐에 넘긴 뒤 바로 리턴하므로
+// 서버 하나가 여러 시청자와 제어 (WebSocket) 요청을 함께 처리할 수 있다.
+// 한 번 보내고 끝나는 큰 응답 (/blackbox, /snapshot) 도 같은 전송 태스크에서 보낸다 (stream_job_start).
+// httpd 태스크는 제어 명령을 처리하므로 큰 응답을 보내느라 붙잡혀 있으면 안 된다.
+
+// 전송 태스크 수 = 동시에 볼 수 있는 최대 스트림 수
+#define STREAM_SENDER_TASKS 3
+#define STREAM_SENDER_STACK 4096
+
+// 지연 통계를 몇 프레임마다 출력할지 (0 이면 출력하지 않음)
+#define STREAM_LATENCY_REPORT 100
+// 캡처부터 마지막 바이트 전송까지 이보다 오래 걸린 프레임은 늦은 프레임으로 센다
+#define STREAM_LATE_US 200000
+
+// 느린 클라이언트 처리.
+// 프레임을 보내기 시작할 때 소켓에 자리가 없으면 그 클라이언트에게는 이 프레임을 건너뛴다.
+// 프레임 하나를 STREAM_SEND_DEADLINE_US 안에 다 보내지 못하면 지연 (stall) 으로 세고
+// 세션을 한 단계 강등한다 (2^n 프레임에 하나만 보냄). 최대로 강등된 뒤에도 지연되거나
+// STREAM_EVICT_US 동안 소켓에 한 바이트도 쓰지 못하면 세션을 끊는다 (eviction).
+#define STREAM_SEND_DEADLINE_US 250000
+#define STREAM_EVICT_US 3000000
+#define STREAM_DEMOTE_MAX 3
+// 제때 보낸 프레임이 이만큼 이어지면 한 단계 올린다
+#define STREAM_PROMOTE_FRAMES 30
+
+// 1 이면 chunked 인코딩으로 보낸다. 0 이면 연결이 끝날 때까지 그대로 보낸다
+// (multipart 자체가 경계로 나뉘므로 chunk 헤더가 필요 없다).
+#define STREAM_CHUNKED 1
+
+#define PART_BOUNDARY "123456789000000000000987654321"
+static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
+static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
+// X-Timestamp: esp_camera_fb_get() 때의 캡처 시각 (초.마이크로초, esp_timer 기준)
+// X-Frame-Seq: 캡처 태스크가 붙인 프레임 번호 (건너뛴 프레임은 번호가 빈다)
+static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n"
+                                  "X-Timestamp: %d.%06d\r\nX-Frame-Seq: %u\r\n\r\n";
+// 텐서 모드 (/alt_stream?format=gray|rgb&size=96) 의 파트 헤더
+static const char *_STREAM_TENSOR_PART = "Content-Type: application/octet-stream\r\nContent-Length: %u\r\n"
+                                         "X-Tensor-Shape: 1,%d,%d,%d\r\nX-Tensor-Layout: NHWC\r\n"
+                                         "X-Timestamp: %d.%06d\r\nX-Frame-Seq: %u\r\n\r\n";
+#if STREAM_CHUNKED
+// 경계 뒤에 chunk 를 끝내는 CRLF 를 붙여서 한 번에 보낸다
+static const char *_STREAM_BOUNDARY_CHUNK = "\r\n--" PART_BOUNDARY "\r\n\r\n";
+static const char *_STREAM_RESP_HDR = "HTTP/1.1 200 OK\r\n"
+                                      "Content-Type: multipart/x-mixed-replace;boundary=" PART_BOUNDARY "\r\n"
+                                      "Transfer-Encoding: chunked\r\n"
+                                      "Access-Control-Allow-Origin: *\r\n"
+                                      "\r\n";
+#else
+static const char *_STREAM_RESP_HDR = "HTTP/1.1 200 OK\r\n"
+                                      "Content-Type: multipart/x-mixed-replace;boundary=" PART_BOUNDARY "\r\n"
+                                      "Connection: close\r\n"
+                                      "Access-Control-Allow-Origin: *\r\n"
+                                      "\r\n";
+#endif
+
+// 세션 종류
+typedef enum {
+    STREAM_MULTIPART = 0,    // multipart/x-mixed-replace HTTP 응답
+    STREAM_WEBSOCKET,        // WebSocket 바이너리 프레임 (/video_ws)
+    STREAM_UDP,              // UDP JPEG 조각 (udp_frame_proto.h, /alt_ws 의 udp_stream 명령)
+    STREAM_JOB,              // 한 번 보내고 끝나는 응답 (stream_job_start)
+} stream_kind_t;
+
+// WebSocket 비디오 프레임의 앞에 붙는 고정 헤더 (little endian)
+// seq: 프레임 번호, timestamp_us: 캡처 시각 (esp_timer), size: 뒤따르는 JPEG 크기
+#define STREAM_WS_HDR_LEN 16
+// 클라이언트가 크레딧을 보내기 전에 보낼 수 있는 프레임 수
+#define STREAM_WS_INITIAL_CREDITS 2
+// 쌓아둘 수 있는 크레딧 상한. 한 번에 보낸 값이 이보다 크면 무시한다 (잘못된 클라이언트가
+// 큰 값이나 int 를 넘치는 값을 보내도 흐름 제어가 풀리지 않게).
+#define STREAM_WS_MAX_CREDITS (STREAM_WS_INITIAL_CREDITS * 4)
+// 제어 프레임 (PING/PONG) 페이로드 최대 길이 (RFC 6455)
+#define STREAM_WS_CONTROL_MAX 125
+
+// UDP 조각을 보낼 때 lwip 버퍼가 모자라면 (ENOMEM) 몇 번까지 1 tick 쉬고 다시 보낼지.
+// 그래도 안 되면 남은 조각은 보내지 않는다 (수신 측이 그 프레임을 버린다).
+#define STREAM_UDP_RETRY 3
+
+typedef struct stream_ctx stream_ctx_t;
+
+// 소켓 전송 함수 (scatter/gather). 보낸 바이트 수 또는 음수 (에러) 를 돌려준다.
+// 장치에서는 lwip_sendmsg (MSG_DONTWAIT) 를 쓰고, 호스트에서는 가짜 소켓으로 바꿀 수 있다.
+typedef int (*stream_send_fn_t)(stream_ctx_t *ctx, const struct iovec *iov, int iovcnt);
+
+// 전송 태스크에서 응답 하나를 보내는 함수. HTTP 응답 헤더부터 직접 쓴다 (stream_job_write).
+typedef esp_err_t (*stream_job_fn_t)(stream_ctx_t *ctx, void *arg);
+
+// 스트림 클라이언트 하나의 상태
+struct stream_ctx {
+    const char *name;        // 로그용 이름
+    int sub;                 // frame_subscribe() 로 받은 구독 번호
+    httpd_handle_t server;   // 세션을 가진 서버
+    int fd;                  // 클라이언트 소켓
+    volatile bool closed;    // 서버가 소켓을 닫았음
+    stream_kind_t kind;
+    int credits;             // WebSocket: 클라이언트가 더 받을 수 있는 프레임 수
+    bool pong_pending;       // WebSocket: 보낼 PONG 이 있음 (httpd 태스크가 세우고 전송 태스크가 내린다)
+    uint8_t pong_len;
+    uint8_t pong[STREAM_WS_CONTROL_MAX];  // 받은 PING 의 페이로드
+    stream_send_fn_t send_fn;
+    uint32_t last_seq;       // 마지막으로 보낸 프레임 번호
+    uint32_t sent;           // 보낸 프레임 수
+    uint32_t dropped;        // 늦어서 건너뛴 프레임 수 (뒤처진 정도)
+    uint64_t wire_bytes;     // 소켓에 쓴 바이트 수 (헤더 포함)
+    uint32_t send_calls;     // 소켓 전송 호출 수
+    stats_hist_t send_us;    // 프레임 하나를 보내는 데 걸린 시간, amount = 바이트 수
+    stats_hist_t latency_us; // 캡처 시각부터 마지막 바이트 전송까지의 지연
+    uint32_t late;           // STREAM_LATE_US 보다 늦게 도착한 프레임 수
+    dl_matrix3du_t *tensor;  // 텐서 모드 출력 버퍼 (NULL 이면 JPEG 그대로 보낸다)
+    stats_hist_t prep_us;    // 텐서 변환 / ROI 자르기 시간
+    uint32_t peer_ip;        // 클라이언트 IP (network byte order, ROI 설정을 찾는 데 쓴다)
+    uint64_t roi_req;        // 요청된 ROI (roi_pack, 0 = 전체). 제어 태스크가 쓴다
+    uint64_t roi_cur;        // 버퍼를 잡아둔 ROI. 전송 태스크만 쓴다
+    roi_rect_t roi_rect;     // roi_cur 를 지금 프레임 크기에 맞춘 것
+    uint16_t roi_frame_w;    // roi_rect 를 맞춘 프레임 폭
+    uint8_t *roi_rgb;        // ROI 디코딩 버퍼 (w * h * 3)
+    uint8_t *roi_jpg;        // ROI 인코딩 결과
+    size_t roi_jpg_cap;
+    uint32_t stalls;         // STREAM_SEND_DEADLINE_US 를 넘긴 프레임 수
+    uint32_t backpressure;   // 소켓에 자리가 없어서 건너뛴 프레임 수
+    int demote;              // 강등 단계 (0 = 모든 프레임을 보냄)
+    int skipped;             // 강등으로 연속해서 건너뛴 프레임 수
+    int on_time;             // 제때 보낸 연속 프레임 수
+    int64_t blocked_since;   // 소켓에 자리가 없기 시작한 시각 (0 이면 보낼 수 있음)
+    bool evicted;            // 느려서 끊긴 세션
+    int64_t last_sent_us;    // 마지막으로 프레임을 보낸 시각
+    uint32_t suppressed;     // 정지 화면이라 보내지 않은 프레임 수
+    uint64_t saved_bytes;    // 그 프레임들의 JPEG 바이트 합
+    struct sockaddr_in udp_dest;  // UDP: 받는 쪽 주소
+    uint32_t udp_partial;    // UDP: 조각을 다 보내지 못한 프레임 수
+    stream_job_fn_t job;     // STREAM_JOB: 보낼 함수와 인자
+    void *job_arg;
+};
+
+// 구독 번호로 찾는 클라이언트 표. name 이 NULL 이면 빈 자리.
+static stream_ctx_t stream_clients[FRAME_MAX_SUBSCRIBERS];
+
+// 클라이언트 IP 별 ROI 설정. 스트림이 나중에 열려도 적용된다.
+typedef struct {
+    uint32_t ip;
+    uint64_t roi;
+} stream_roi_pref_t;
+
+static stream_roi_pref_t stream_roi_prefs[FRAME_MAX_SUBSCRIBERS];
+
+// 한 번 보내고 끝나는 응답. 프레임을 구독하지 않으므로 stream_clients 와 따로 둔다.
+#define STREAM_JOB_MAX 2
+static stream_ctx_t stream_jobs[STREAM_JOB_MAX];
+
+static QueueHandle_t stream_queue = NULL;
+static uint32_t stream_evictions = 0;  // 느려서 끊은 세션 수
+static int stream_idle_senders = 0;  // 세션을 기다리고 있는 전송 태스크 수
+
+// app_server.h 의 캡처 태스크 관리
+void capture_client_join();
+void capture_client_leave();
+
+// 소켓에 쓸 자리가 생길 때까지 timeout_us 만큼 기다린다.
+// 1 이면 쓸 수 있음, 0 이면 시간 초과, -1 이면 select 실패 (소켓이 망가졌거나 닫혔다).
+static int stream_sock_writable(int fd, int64_t timeout_us) {
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    struct timeval tv = { (time_t)(timeout_us / 1000000), (suseconds_t)(timeout_us % 1000000) };
+    int n = lwip_select(fd + 1, NULL, &wfds, NULL, &tv);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    return n > 0 ? 1 : 0;
+}
+
+// 블록하지 않고 쓸 수 있는 만큼 쓴다. 자리가 없으면 기다리되
+// STREAM_EVICT_US 동안 한 바이트도 못 쓰면 세션을 끊는다. select 가 실패하면 기다리지 않고 -1.
+static int stream_sock_send(stream_ctx_t *ctx, const struct iovec *iov, int iovcnt) {
+    int64_t start = esp_timer_get_time();
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec *)iov;
+    msg.msg_iovlen = iovcnt;
+
+    // 서버가 이미 닫은 소켓이면 보내지 않는다 (fd 가 재사용되었을 수 있다)
+    while (!ctx->closed) {
+        int writable = stream_sock_writable(ctx->fd, 100000);  // 100 ms 마다 closed 를 다시 본다
+        if (writable < 0) {
+            LOG_W("%s: select failed: %d", ctx->name, errno);
+            return -1;
+        }
+        if (writable) {
+            int n = lwip_sendmsg(ctx->fd, &msg, MSG_DONTWAIT);
+            if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                return n;
+            }
+        }
+        if (esp_timer_get_time() - start > STREAM_EVICT_US) {
+            ctx->evicted = true;
+            return -1;
+        }
+    }
+    return -1;
+}
+
+// 프레임을 보내기 전에 이 클라이언트에게 보낼지 정한다. 건너뛸 프레임이면 false.
+// 오래 막혀 있으면 evicted 를 세운다.
+static bool stream_admit_frame(stream_ctx_t *ctx) {
+    if (ctx->kind == STREAM_UDP) {
+        return true;
+    }
+    // select 가 실패하면 (-1) 보내 보고 그 오류로 세션을 끝낸다
+    if (stream_sock_writable(ctx->fd, 0) == 0) {
+        // 아직 이전 프레임을 다 내보내지 못했다. 기다리지 않고 이 프레임을 건너뛴다.
+        int64_t now = esp_timer_get_time();
+        if (ctx->blocked_since == 0) {
+            ctx->blocked_since = now;
+        } else if (now - ctx->blocked_since > STREAM_EVICT_US) {
+            ctx->evicted = true;
+        }
+        ctx->backpressure++;
+        return false;
+    }
+    ctx->blocked_since = 0;
+    if (ctx->skipped < (1 << ctx->demote) - 1) {
+        ctx->skipped++;  // 강등된 세션은 2^demote 프레임에 하나만 보낸다
+        return false;
+    }
+    ctx->skipped = 0;
+    return true;
+}
+
+// 프레임 하나를 보낸 시간으로 강등/복귀를 정한다. 끊어야 하면 false.
+static bool stream_check_deadline(stream_ctx_t *ctx, uint32_t send_us) {
+    if (ctx->kind == STREAM_UDP) {
+        return true;
+    }
+    if (send_us <= STREAM_SEND_DEADLINE_US) {
+        if (ctx->demote > 0 && ++ctx->on_time >= STREAM_PROMOTE_FRAMES) {
+            ctx->demote--;
+            ctx->on_time = 0;
+            LOG_I("%s promoted to 1/%d frames", ctx->name, 1 << ctx->demote);
+        }
+        return true;
+    }
+    ctx->stalls++;
+    ctx->on_time = 0;
+    if (ctx->demote >= STREAM_DEMOTE_MAX) {
+        ctx->evicted = true;
+        return false;
+    }
+    ctx->demote++;
+    LOG_W("%s stalled (%u us), demoted to 1/%d frames", ctx->name, (unsigned)send_us, 1 << ctx->demote);
+    return true;
+}
+
+// iov 전체를 보낸다. 부분 전송되면 남은 부분부터 이어서 보낸다 (iov 를 수정한다).
+static esp_err_t stream_send_iov(stream_ctx_t *ctx, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        int n = ctx->send_fn(ctx, iov, iovcnt);
+        ctx->send_calls++;
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        ctx->wire_bytes += n;
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return ESP_OK;
+}
+
+// UDP 조각 하나 (헤더 + 조각 데이터) 를 데이터그램 하나로 보낸다
+static int stream_udp_sock_send(stream_ctx_t *ctx, const struct iovec *iov, int iovcnt) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &ctx->udp_dest;
+    msg.msg_namelen = sizeof(ctx->udp_dest);
+    msg.msg_iov = (struct iovec *)iov;
+    msg.msg_iovlen = iovcnt;
+    return lwip_sendmsg(ctx->fd, &msg, 0);
+}
+
+// JPEG 을 UDP_FRAG_PAYLOAD 크기로 잘라서 보낸다. 조각 데이터는 카메라 버퍼를 그대로 가리킨다.
+// 버퍼 부족으로 일부 조각을 못 보내도 세션은 계속한다. 소켓 에러일 때만 ESP_FAIL.
+static esp_err_t stream_udp_send(stream_ctx_t *ctx, const uint8_t *buf, size_t len,
+                                 uint32_t seq, int64_t captured_us) {
+    if (ctx->closed) {
+        return ESP_FAIL;  // stream_udp_stop(ip)
+    }
+    udp_frag_hdr_t hdr;
+    hdr.magic = UDP_FRAG_MAGIC;
+    hdr.version = UDP_FRAG_VERSION;
+    hdr.flags = 0;
+    hdr.frame_id = seq;
+    hdr.frag_count = (len + UDP_FRAG_PAYLOAD - 1) / UDP_FRAG_PAYLOAD;
+    hdr.frame_len = len;
+    hdr.timestamp_us = captured_us;
+
+    for (uint16_t i = 0; i < hdr.frag_count; i++) {
+        size_t off = (size_t)i * UDP_FRAG_PAYLOAD;
+        hdr.frag_index = i;
+        struct iovec iov[2];
+        iov[0] = { &hdr, sizeof(hdr) };
+        iov[1] = { (void *)(buf + off), len - off < (size_t)UDP_FRAG_PAYLOAD ? len - off : (size_t)UDP_FRAG_PAYLOAD };
+        int n;
+        int retry = 0;
+        while ((n = ctx->send_fn(ctx, iov, 2)) < 0 && (errno == ENOMEM || errno == EAGAIN) &&
+               retry++ < STREAM_UDP_RETRY) {
+            ctx->send_calls++;
+            vTaskDelay(1);
+        }
+        ctx->send_calls++;
+        if (n < 0) {
+            if (errno == ENOMEM || errno == EAGAIN) {
+                ctx->udp_partial++;
+                return ESP_OK;
+            }
+            return ESP_FAIL;
+        }
+        ctx->wire_bytes += n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t stream_send_all(stream_ctx_t *ctx, const char *buf, size_t len) {
+    struct iovec iov = { (void *)buf, len };
+    return stream_send_iov(ctx, &iov, 1);
+}
+
+// 서버 -> 클라이언트 WebSocket 바이너리 프레임 헤더 (마스크 없음) 와 고정 헤더를 쓴다.
+// 쓴 길이를 돌려준다 (최대 10 + STREAM_WS_HDR_LEN).
+static size_t stream_ws_header(uint8_t *out, size_t jpg_len, uint32_t seq, int64_t captured_us) {
+    uint64_t len = STREAM_WS_HDR_LEN + jpg_len;
+    size_t n = 0;
+
+    out[n++] = 0x82;  // FIN + binary
+    if (len < 126) {
+        out[n++] = len;
+    } else if (len < 65536) {
+        out[n++] = 126;
+        out[n++] = len >> 8;
+        out[n++] = len;
+    } else {
+        out[n++] = 127;
+        for (int i = 7; i >= 0; i--) {
+            out[n++] = len >> (i * 8);
+        }
+    }
+    uint32_t size = jpg_len;
+    uint64_t ts = captured_us;
+    memcpy(out + n, &seq, 4);       // ESP32 는 little endian
+    memcpy(out + n + 4, &ts, 8);
+    memcpy(out + n + 12, &size, 4);
+    return n + STREAM_WS_HDR_LEN;
+}
+
+// 받은 PING 에 PONG 으로 답한다. 소켓은 전송 태스크만 쓰므로 프레임 사이에서 보낸다.
+static esp_err_t stream_ws_send_pong(stream_ctx_t *ctx) {
+    uint8_t buf[2 + STREAM_WS_CONTROL_MAX];
+    size_t len = ctx->pong_len;
+    buf[0] = 0x8A;  // FIN + pong
+    buf[1] = len;
+    memcpy(buf + 2, ctx->pong, len);
+    __atomic_store_n(&ctx->pong_pending, false, __ATOMIC_RELEASE);  // 복사했으므로 다음 PING 을 받는다
+    return stream_send_all(ctx, (const char *)buf, 2 + len);
+}
+
+// 세션이 가진 버퍼를 돌려준다 (전송 태스크 또는 큐에 넣기 전의 httpd 태스크)
+static void stream_free_buffers(stream_ctx_t *ctx) {
+    block_free(ctx->tensor);
+    ctx->tensor = NULL;
+    block_free(ctx->roi_rgb);
+    block_free(ctx->roi_jpg);
+    ctx->roi_rgb = NULL;
+    ctx->roi_jpg = NULL;
+    ctx->roi_cur = 0;
+}
+
+// 요청된 ROI 에 맞게 버퍼를 다시 잡는다. 전송 태스크에서만 호출한다.
+// ROI 는 최대 해상도 (adapt_config.size_max) 기준이므로 적응 제어가 해상도를 낮췄으면 같이 줄인다.
+// 버퍼를 잡지 못하면 전체 프레임을 보낸다.
+static void stream_roi_apply(stream_ctx_t *ctx, uint64_t roi_req, int frame_w, int frame_h) {
+    block_free(ctx->roi_rgb);
+    block_free(ctx->roi_jpg);
+    ctx->roi_rgb = NULL;
+    ctx->roi_jpg = NULL;
+    ctx->roi_cur = roi_req;
+    ctx->roi_frame_w = frame_w;
+    if (roi_req == 0) {
+        LOG_I("%s: ROI off", ctx->name);
+        return;
+    }
+    roi_rect_t r = roi_unpack(roi_req);
+    const resolution_info_t *full = &resolution[adapt_config.size_max];
+    if (full->width != frame_w) {
+        r = roi_scale(r, full->width, full->height, frame_w, frame_h);
+    }
+    ctx->roi_rect = r;
+    // 다시 인코딩한 JPEG 은 화소당 1 바이트를 넘지 않는다 (품질 80 기준 여유 있음)
+    ctx->roi_jpg_cap = (size_t)r.w * r.h;
+    ctx->roi_rgb = (uint8_t *)block_alloc((size_t)r.w * r.h * 3);
+    ctx->roi_jpg = (uint8_t *)block_alloc(ctx->roi_jpg_cap);
+    if (!ctx->roi_rgb || !ctx->roi_jpg) {
+        LOG_E("%s: failed to allocate ROI buffers", ctx->name);
+        block_free(ctx->roi_rgb);
+        block_free(ctx->roi_jpg);
+        ctx->roi_rgb = NULL;
+        ctx->roi_jpg = NULL;
+        return;
+    }
+    LOG_I("%s: ROI %d,%d %dx%d", ctx->name, r.x, r.y, r.w, r.h);
+}
+
+static esp_err_t send_frame(stream_ctx_t *ctx) {
+    esp_err_t res = ESP_OK;
+    char part_hdr[192];
+    char part_buf[208];
+    size_t hlen = 0;
+
+    if (ctx->kind == STREAM_WEBSOCKET && __atomic_load_n(&ctx->pong_pending, __ATOMIC_ACQUIRE) &&
+        stream_ws_send_pong(ctx) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (ctx->kind == STREAM_WEBSOCKET && __atomic_load_n(&ctx->credits, __ATOMIC_ACQUIRE) <= 0) {
+        // 클라이언트에 받을 자리가 없다. 크레딧이 오거나 (stream_ws_credit) 시간이 지날 때까지 기다린다.
+        // 그 사이 게시된 프레임은 이 클라이언트에게는 건너뛴 프레임이 된다.
+        xSemaphoreTake(frame_subs[ctx->sub].sem, pdMS_TO_TICKS(1000));
+        return ctx->closed ? ESP_FAIL : ESP_OK;
+    }
+
+    // 아직 보내지 않은 새 프레임이 게시될 때까지 기다린다 (참조만 빌려온다)
+    frame_ref_t *frame = frame_wait(ctx->sub, ctx->last_seq, pdMS_TO_TICKS(1000));
+    if (!frame) {
+        // 캡처가 멈춘 경우 다시 기다린다
+        return ctx->closed ? ESP_FAIL : ESP_OK;
+    }
+
+    int64_t work_start = esp_timer_get_time();  // 여기부터 task_busy_add 로 센다
+    if (frame->still && work_start - ctx->last_sent_us < STILL_KEEPALIVE_US) {
+        // 마지막으로 보낸 프레임과 거의 같다. keep-alive 간격이 지날 때까지 보내지 않는다.
+        ctx->suppressed++;
+        ctx->saved_bytes += frame->fb->len;
+        ctx->last_seq = frame->seq;
+        frame_release(frame);
+        return ESP_OK;
+    }
+    if (!stream_admit_frame(ctx)) {
+        // 이 클라이언트에게는 건너뛴 프레임
+        ctx->dropped++;
+        ctx->last_seq = frame->seq;
+        frame_release(frame);
+        return ctx->evicted ? ESP_FAIL : ESP_OK;
+    }
+
+    const uint8_t *_jpg_buf = frame->fb->buf;
+    size_t _jpg_buf_len = frame->fb->len;
+    uint32_t seq = frame->seq;
+    int64_t captured_us = frame->captured_us;
+    struct timeval ts = frame->fb->timestamp;
+    size_t part_len = 0;
+
+    uint64_t roi_req = __atomic_load_n(&ctx->roi_req, __ATOMIC_ACQUIRE);
+    if (!ctx->tensor && (roi_req != ctx->roi_cur || (roi_req && frame->fb->width != ctx->roi_frame_w))) {
+        stream_roi_apply(ctx, roi_req, frame->fb->width, frame->fb->height);
+    }
+
+    if (ctx->tensor) {
+        // 텐서로 변환한 뒤에는 카메라 버퍼가 필요 없으므로 바로 돌려준다
+        dl_matrix3du_t *t = ctx->tensor;
+        int64_t prep_start = esp_timer_get_time();
+        bool ok = tensor_from_jpeg(frame->fb, t);
+        stats_hist_add(&ctx->prep_us, esp_timer_get_time() - prep_start, 0);
+        frame_release(frame);
+        frame = NULL;
+        if (!ok) {
+            LOG_E("%s: tensor conversion failed", ctx->name);
+            ctx->last_seq = seq;
+            return ESP_OK;
+        }
+        _jpg_buf = t->item;
+        _jpg_buf_len = t->w * t->h * t->c;
+        part_len = snprintf(part_hdr, sizeof(part_hdr), _STREAM_TENSOR_PART, _jpg_buf_len,
+                            t->h, t->w, t->c, (int)ts.tv_sec, (int)ts.tv_usec, (unsigned)seq);
+    } else {
+        if (ctx->roi_rgb) {
+            // ROI 만 다시 인코딩한다. 그 뒤에는 카메라 버퍼가 필요 없다.
+            int64_t prep_start = esp_timer_get_time();
+            _jpg_buf_len = roi_crop_jpeg(frame->fb, ctx->roi_rect, ctx->roi_rgb,
+                                         ctx->roi_jpg, ctx->roi_jpg_cap);
+            stats_hist_add(&ctx->prep_us, esp_timer_get_time() - prep_start, 0);
+            frame_release(frame);
+            frame = NULL;
+            if (_jpg_buf_len == 0) {
+                LOG_E("%s: ROI crop failed", ctx->name);
+                ctx->last_seq = seq;
+                return ESP_OK;
+            }
+            _jpg_buf = ctx->roi_jpg;
+        }
+        if (ctx->kind == STREAM_MULTIPART) {
+            part_len = snprintf(part_hdr, sizeof(part_hdr), _STREAM_PART, _jpg_buf_len,
+                                (int)ts.tv_sec, (int)ts.tv_usec, (unsigned)seq);
+        }
+    }
+
+    struct iovec iov[3];
+    int iovcnt = 0;
+    if (ctx->kind == STREAM_UDP) {
+        // 조각마다 따로 보낸다 (아래 stream_udp_send)
+    } else if (ctx->kind == STREAM_WEBSOCKET) {
+        // WebSocket 프레임 헤더 + 고정 헤더, JPEG 을 한 번의 writev 로 보낸다
+        hlen = stream_ws_header((uint8_t *)part_buf, _jpg_buf_len, seq, captured_us);
+        iov[0] = { part_buf, hlen };
+        iov[1] = { (void *)_jpg_buf, _jpg_buf_len };
+        iovcnt = 2;
+    } else {
+        // 파트 헤더, JPEG, 경계를 JPEG 복사 없이 한 번의 writev 로 보낸다
+#if STREAM_CHUNKED
+        size_t tail_len = strlen(_STREAM_BOUNDARY);
+        hlen = snprintf(part_buf, sizeof(part_buf), "%x\r\n%s",
+                        (unsigned)(part_len + _jpg_buf_len + tail_len), part_hdr);
+        const char *tail = _STREAM_BOUNDARY_CHUNK;
+        tail_len += 2;
+#else
+        hlen = snprintf(part_buf, sizeof(part_buf), "%s", part_hdr);
+        const char *tail = _STREAM_BOUNDARY;
+        size_t tail_len = strlen(_STREAM_BOUNDARY);
+#endif
+        iov[0] = { part_buf, hlen };
+        iov[1] = { (void *)_jpg_buf, _jpg_buf_len };
+        iov[2] = { (void *)tail, tail_len };
+        iovcnt = 3;
+    }
+    uint64_t bytes_before = ctx->wire_bytes;
+    int64_t send_start = esp_timer_get_time();
+    if (ctx->kind == STREAM_UDP) {
+        res = stream_udp_send(ctx, _jpg_buf, _jpg_buf_len, seq, captured_us);
+    } else {
+        res = stream_send_iov(ctx, iov, iovcnt);
+    }
+    uint32_t send_us = esp_timer_get_time() - send_start;
+    stats_hist_add(&ctx->send_us, send_us, ctx->wire_bytes - bytes_before);
+    // UDP 는 보내기 호출이 네트워크 속도를 기다리지 않으므로 처리량 추정에 넣지 않는다
+    if (res == ESP_OK && !ctx->tensor && !ctx->roi_rgb && ctx->kind != STREAM_UDP) {
+        adapt_observe(send_us, _jpg_buf_len);
+    }
+
+    if (res == ESP_OK && !stream_check_deadline(ctx, send_us)) {
+        res = ESP_FAIL;
+    }
+
+    if (res == ESP_OK) {
+        // 보내지 못하고 건너뛴 프레임 수 (첫 프레임은 제외)
+        if (ctx->last_seq != 0) {
+            ctx->dropped += seq - ctx->last_seq - 1;
+        }
+        ctx->last_seq = seq;
+        ctx->last_sent_us = esp_timer_get_time();
+        ctx->sent++;
+        if (ctx->kind == STREAM_WEBSOCKET) {
+            __atomic_sub_fetch(&ctx->credits, 1, __ATOMIC_ACQ_REL);
+        }
+
+        // 캡처 시각 ~ 마지막 바이트 전송 지연
+        int64_t latency = esp_timer_get_time() - captured_us;
+        stats_hist_add(&ctx->latency_us, latency, 0);
+        if (latency > STREAM_LATE_US) {
+            ctx->late++;
+        }
+        if (STREAM_LATENCY_REPORT > 0 && ctx->sent % STREAM_LATENCY_REPORT == 0) {
+            stats_summary_t lat;
+            stats_hist_summary(&ctx->latency_us, &lat);
+            // 로그 인자는 LOG_MAX_ARGS 개까지라서 두 줄로 나눈다
+            LOG_I("%s latency p50 %u us, p95 %u us, p99 %u us, late %d",
+                  ctx->name, (unsigned)lat.p50, (unsigned)lat.p95, (unsigned)lat.p99, (int)ctx->late);
+            LOG_I("%s sent %d, dropped %d, %d bytes/frame, %d.%02d sends/frame",
+                  ctx->name, (int)ctx->sent, (int)ctx->dropped, (int)(ctx->wire_bytes / ctx->sent),
+                  (int)(ctx->send_calls / ctx->sent), (int)(ctx->send_calls * 100 / ctx->sent % 100));
+        }
+    }
+    // 전송이 끝났으므로 참조 해제 (마지막 참조면 카메라로 반환)
+    frame_release(frame);  // 텐서 모드에서는 이미 해제됨 (NULL)
+    task_busy_add(esp_timer_get_time() - work_start);
+
+    return res;
+}
+
+// 세션 종료 정리
+static void stream_session_end(stream_ctx_t *ctx) {
+    LOG_I("end %s, sent %d frames, dropped %d, stalls %d%s", ctx->name, (int)ctx->sent,
+          (int)ctx->dropped, (int)ctx->stalls, ctx->evicted ? ", evicted" : "");
+    if (ctx->evicted) {
+        stream_evictions++;
+    }
+    if (ctx->kind == STREAM_UDP) {
+        lwip_close(ctx->fd);  // UDP 소켓은 세션이 직접 가지고 있다
+    } else if (!ctx->closed) {
+        // 전송 실패로 끝난 경우 서버에 소켓을 닫도록 요청
+        httpd_sess_trigger_close(ctx->server, ctx->fd);
+    }
+    int sub = ctx->sub;
+    ctx->name = NULL;
+    stream_free_buffers(ctx);
+    frame_unsubscribe(sub);
+    capture_client_leave();
+}
+
+// 응답 하나를 보내고 연결을 닫는다 (응답 헤더는 Connection: close)
+static void stream_job_run(stream_ctx_t *ctx) {
+    int64_t start = esp_timer_get_time();
+    esp_err_t res = ctx->job(ctx, ctx->job_arg);
+    task_busy_add(esp_timer_get_time() - start);
+    LOG_I("end %s, %u bytes in %u ms%s", ctx->name, (unsigned)ctx->wire_bytes,
+          (unsigned)((esp_timer_get_time() - start) / 1000), res == ESP_OK ? "" : " (aborted)");
+    if (!ctx->closed) {
+        httpd_sess_trigger_close(ctx->server, ctx->fd);
+    }
+    __atomic_store_n(&ctx->name, (const char *)NULL, __ATOMIC_RELEASE);
+}
+
+// 전송 태스크. 큐에서 세션을 받아 끝날 때까지 프레임을 보낸다.
+static void stream_sender_task(void *param) {
+    stream_ctx_t *ctx;
+    while (true) {
+        if (xQueueReceive(stream_queue, &ctx, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (ctx->kind == STREAM_JOB) {
+            stream_job_run(ctx);
+        } else {
+            while (send_frame(ctx) == ESP_OK) {
+            }
+            stream_session_end(ctx);
+        }
+        __atomic_add_fetch(&stream_idle_senders, 1, __ATOMIC_RELEASE);
+    }
+}
+
+void stream_sender_init() {
+    tensor_prep_init();
+    stream_queue = xQueueCreate(STREAM_SENDER_TASKS, sizeof(stream_ctx_t *));
+    stream_idle_senders = STREAM_SENDER_TASKS;
+    for (int i = 0; i < STREAM_SENDER_TASKS; i++) {
+        task_create(stream_sender_task, "stream_sender", STREAM_SENDER_STACK, NULL,
+                    TASK_PRIO_SENDER, TASK_CORE_SENDER, NULL);
+    }
+}
+
+// httpd 의 close_fn. 스트림 세션의 소켓이 닫히면 전송 태스크에 알린다.
+// 텔레메트리 구독도 여기서 푼다.
+static void stream_close_fn(httpd_handle_t hd, int sockfd) {
+    telemetry_unsubscribe(hd, sockfd);
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        stream_ctx_t *ctx = &stream_clients[i];
+        if (ctx->name && ctx->server == hd && ctx->fd == sockfd) {
+            ctx->closed = true;
+        }
+    }
+    for (int i = 0; i < STREAM_JOB_MAX; i++) {
+        stream_ctx_t *ctx = &stream_jobs[i];
+        if (ctx->name && ctx->server == hd && ctx->fd == sockfd) {
+            ctx->closed = true;
+        }
+    }
+    close(sockfd);  // close_fn 을 지정하면 소켓은 직접 닫아야 한다
+}
+
+// 텐서 모드 출력 버퍼 (구조체 + NHWC 데이터) 를 large 블록 하나로 할당한다
+static dl_matrix3du_t *stream_tensor_alloc(int w, int h, int c) {
+    dl_matrix3du_t *t = (dl_matrix3du_t *)block_alloc(sizeof(dl_matrix3du_t) + w * h * c);
+    if (!t) {
+        return NULL;
+    }
+    t->w = w;
+    t->h = h;
+    t->c = c;
+    t->n = 1;
+    t->stride = w * c;
+    t->item = (uc_t *)(t + 1);
+    return t;
+}
+
+// 스트림 핸들러에서 호출. 응답 헤더를 보내고 세션을 전송 태스크에 넘긴다.
+// tensor_size 가 0 이 아니면 JPEG 대신 tensor_size x tensor_size x tensor_channels 텐서를 보낸다.
+// WebSocket 세션은 이미 핸드셰이크가 끝났으므로 HTTP 에러 대신 연결을 닫는다.
+static esp_err_t stream_reject(httpd_req_t *req, stream_kind_t kind) {
+    return kind == STREAM_WEBSOCKET ? ESP_FAIL : httpd_resp_send_500(req);
+}
+
+// 이 클라이언트 IP 에 ROI 설정이 있으면 세션에 건다 (텐서 모드는 제외)
+static void stream_roi_lookup(stream_ctx_t *ctx, uint32_t ip) {
+    ctx->peer_ip = ip;
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        if (stream_roi_prefs[i].roi && stream_roi_prefs[i].ip == ip) {
+            ctx->roi_req = stream_roi_prefs[i].roi;
+        }
+    }
+}
+
+// 전송 태스크와 구독 자리를 잡고 세션을 채운다. 자리가 없으면 NULL.
+// 성공하면 stream_session_queue() 로 넘기거나 stream_session_abort() 로 되돌려야 한다.
+static stream_ctx_t *stream_session_open(const char *name, stream_kind_t kind, httpd_handle_t server, int fd,
+                                         int tensor_size, int tensor_channels) {
+    LOG_I("start %s", name);
+
+    // 남는 전송 태스크가 없으면 거절한다
+    if (__atomic_sub_fetch(&stream_idle_senders, 1, __ATOMIC_ACQ_REL) < 0) {
+        __atomic_add_fetch(&stream_idle_senders, 1, __ATOMIC_RELEASE);
+        LOG_W("No free stream sender");
+        return NULL;
+    }
+
+    int sub = frame_subscribe();
+    if (sub < 0) {
+        __atomic_add_fetch(&stream_idle_senders, 1, __ATOMIC_RELEASE);
+        LOG_W("Too many stream clients");
+        return NULL;
+    }
+    stream_ctx_t *ctx = &stream_clients[sub];
+    memset(ctx, 0, sizeof(stream_ctx_t));
+    ctx->sub = sub;
+    ctx->server = server;
+    ctx->fd = fd;
+    ctx->send_fn = stream_sock_send;
+    ctx->kind = kind;
+    ctx->credits = STREAM_WS_INITIAL_CREDITS;
+    stats_hist_reset(&ctx->send_us);
+    stats_hist_reset(&ctx->latency_us);
+    stats_hist_reset(&ctx->prep_us);
+    if (server) {
+        struct sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        if (lwip_getpeername(fd, (struct sockaddr *)&peer, &peer_len) == 0) {
+            stream_roi_lookup(ctx, peer.sin_addr.s_addr);
+        }
+    }
+    if (tensor_size > 0) {
+        ctx->tensor = stream_tensor_alloc(tensor_size, tensor_size, tensor_channels);
+        if (!ctx->tensor) {
+            LOG_E("Failed to allocate tensor buffer");
+            frame_unsubscribe(sub);
+            __atomic_add_fetch(&stream_idle_senders, 1, __ATOMIC_RELEASE);
+            return NULL;
+        }
+    }
+    ctx->name = name;
+    return ctx;
+}
+
+static void stream_session_abort(stream_ctx_t *ctx) {
+    int sub = ctx->sub;
+    ctx->name = NULL;
+    stream_free_buffers(ctx);
+    frame_unsubscribe(sub);
+    __atomic_add_fetch(&stream_idle_senders, 1, __ATOMIC_RELEASE);
+}
+
+static void stream_session_queue(stream_ctx_t *ctx) {
+    capture_client_join();
+    xQueueSend(stream_queue, &ctx, portMAX_DELAY);  // 남는 태스크가 있으므로 바로 들어간다
+}
+
+esp_err_t stream_session_start(httpd_req_t *req, const char *name, stream_kind_t kind = STREAM_MULTIPART,
+                               int tensor_size = 0, int tensor_channels = 1) {
+    stream_ctx_t *ctx = stream_session_open(name, kind, req->handle, httpd_req_to_sockfd(req),
+                                            tensor_size, tensor_channels);
+    if (!ctx) {
+        return stream_reject(req, kind);
+    }
+
+    if (kind == STREAM_MULTIPART &&
+        stream_send_all(ctx, _STREAM_RESP_HDR, strlen(_STREAM_RESP_HDR)) != ESP_OK) {
+        stream_session_abort(ctx);
+        return ESP_FAIL;
+    }
+
+    stream_session_queue(ctx);
+    // 응답은 전송 태스크가 이어서 보낸다. 소켓은 열린 채로 둔다.
+    return ESP_OK;
+}
+
+// 큰 응답을 전송 태스크에 넘긴다. fn 이 응답 전체 (HTTP 헤더 포함) 를 stream_job_write 로 쓰고
+// 끝나면 연결을 닫는다. 남는 전송 태스크나 자리가 없으면 false (arg 정리와 에러 응답은 부른 쪽이 한다).
+bool stream_job_start(httpd_req_t *req, const char *name, stream_job_fn_t fn, void *arg) {
+    if (__atomic_sub_fetch(&stream_idle_senders, 1, __ATOMIC_ACQ_REL) < 0) {
+        __atomic_add_fetch(&stream_idle_senders, 1, __ATOMIC_RELEASE);
+        LOG_W("No free stream sender for %s", name);
+        return false;
+    }
+    for (int i = 0; i < STREAM_JOB_MAX; i++) {
+        stream_ctx_t *ctx = &stream_jobs[i];
+        const char *expected = NULL;
+        if (!__atomic_compare_exchange_n(&ctx->name, &expected, name, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        // name 은 자리를 잡았다는 표시이므로 남기고 나머지를 비운다
+        memset((char *)ctx + sizeof(ctx->name), 0, sizeof(stream_ctx_t) - sizeof(ctx->name));
+        ctx->sub = -1;
+        ctx->server = req->handle;
+        ctx->fd = httpd_req_to_sockfd(req);
+        ctx->kind = STREAM_JOB;
+        ctx->send_fn = stream_sock_send;
+        ctx->job = fn;
+        ctx->job_arg = arg;
+        LOG_I("start %s", name);
+        xQueueSend(stream_queue, &ctx, portMAX_DELAY);  // 남는 태스크가 있으므로 바로 들어간다
+        return true;
+    }
+    __atomic_add_fetch(&stream_idle_senders, 1, __ATOMIC_RELEASE);
+    LOG_W("Too many downloads, %s rejected", name);
+    return false;
+}
+
+// 작업 함수에서 응답 바이트를 쓴다. 느린 클라이언트는 stream_sock_send 의 규칙대로 끊긴다.
+esp_err_t stream_job_write(stream_ctx_t *ctx, const void *data, size_t len) {
+    return stream_send_all(ctx, (const char *)data, len);
+}
+
+// ip (network byte order) 로 가는 UDP 세션을 끝낸다 (전송 태스크가 1 초 안에 정리한다).
+// 다른 PC 의 UDP 세션은 그대로 둔다. 끝낸 세션이 있으면 true.
+bool stream_udp_stop(uint32_t ip) {
+    bool stopped = false;
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        stream_ctx_t *ctx = &stream_clients[i];
+        if (ctx->name && ctx->kind == STREAM_UDP && ctx->udp_dest.sin_addr.s_addr == ip) {
+            ctx->closed = true;
+            stopped = true;
+        }
+    }
+    return stopped;
+}
+
+// ip:port (network byte order) 로 UDP JPEG 조각 스트림을 시작한다.
+// 그 ip 로 가는 UDP 세션이 이미 있으면 끝내고 새로 시작한다.
+bool stream_udp_start(uint32_t ip, uint16_t port) {
+    stream_udp_stop(ip);
+
+    int fd = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        LOG_E("Failed to create UDP socket");
+        return false;
+    }
+    stream_ctx_t *ctx = stream_session_open("udp_stream", STREAM_UDP, NULL, fd, 0, 1);
+    if (!ctx) {
+        lwip_close(fd);
+        return false;
+    }
+    ctx->udp_dest.sin_family = AF_INET;
+    ctx->udp_dest.sin_port = port;
+    ctx->udp_dest.sin_addr.s_addr = ip;
+    ctx->send_fn = stream_udp_sock_send;
+    stream_roi_lookup(ctx, ip);
+    stream_session_queue(ctx);
+    return true;
+}
+
+// WebSocket 비디오 세션에 크레딧을 더하고 기다리는 전송 태스크를 깨운다.
+// 합은 STREAM_WS_MAX_CREDITS 에서 멈춘다. 1 ~ STREAM_WS_MAX_CREDITS 밖의 값은 무시한다 (false).
+bool stream_ws_credit(httpd_handle_t server, int fd, int credits) {
+    if (credits <= 0 || credits > STREAM_WS_MAX_CREDITS) {
+        return false;
+    }
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        stream_ctx_t *ctx = &stream_clients[i];
+        if (ctx->name && ctx->kind == STREAM_WEBSOCKET && ctx->server == server && ctx->fd == fd) {
+            // 전송 태스크가 동시에 하나씩 빼므로 CAS 로 더한다
+            int cur = __atomic_load_n(&ctx->credits, __ATOMIC_ACQUIRE);
+            while (!__atomic_compare_exchange_n(&ctx->credits, &cur, min(cur + credits, STREAM_WS_MAX_CREDITS),
+                                                false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            }
+            xSemaphoreGive(frame_subs[ctx->sub].sem);
+            return true;
+        }
+    }
+    return false;
+}
+
+// WebSocket 비디오 세션이 받은 PING 을 전송 태스크에 넘긴다 (PONG 은 다음 프레임 앞에 간다).
+// 앞 PING 에 아직 답하지 않았으면 새 PING 은 버린다 (PONG 하나면 연결이 살아 있다는 뜻은 전해진다).
+bool stream_ws_ping(httpd_handle_t server, int fd, const uint8_t *payload, size_t len) {
+    if (len > STREAM_WS_CONTROL_MAX) {
+        return false;
+    }
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        stream_ctx_t *ctx = &stream_clients[i];
+        if (ctx->name && ctx->kind == STREAM_WEBSOCKET && ctx->server == server && ctx->fd == fd) {
+            if (__atomic_load_n(&ctx->pong_pending, __ATOMIC_ACQUIRE)) {
+                return true;
+            }
+            memcpy(ctx->pong, payload, len);
+            ctx->pong_len = len;
+            __atomic_store_n(&ctx->pong_pending, true, __ATOMIC_RELEASE);
+            xSemaphoreGive(frame_subs[ctx->sub].sem);  // 크레딧을 기다리는 중이면 깨운다
+            return true;
+        }
+    }
+    return false;
+}
+
+// 클라이언트 IP 의 ROI 를 정한다 (w 나 h 가 0 이면 끔). 그 IP 의 열린 JPEG 스트림에 바로 걸리고
+// 나중에 열리는 스트림에도 걸린다. /alt_ws 의 roi 명령에서 호출한다.
+void stream_set_roi(uint32_t ip, int x, int y, int w, int h) {
+    roi_rect_t roi = { 0, 0, 0, 0 };
+    if (w > 0 && h > 0) {
+        roi.x = constrain(x, 0, 0xffff);
+        roi.y = constrain(y, 0, 0xffff);
+        roi.w = constrain(w, 1, 0xffff);
+        roi.h = constrain(h, 1, 0xffff);
+    }
+    if (roi.w && ROI_SNAP_MCU) {
+        roi_snap(&roi);
+    }
+    uint64_t packed = roi_pack(&roi);
+
+    int slot = -1;
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        if (stream_roi_prefs[i].ip == ip || (slot < 0 && stream_roi_prefs[i].roi == 0)) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        slot = 0;  // 자리가 없으면 첫 번째 설정을 덮는다
+    }
+    stream_roi_prefs[slot].ip = ip;
+    stream_roi_prefs[slot].roi = packed;
+
+    for (int i = 0; i < FRAME_MAX_SUBSCRIBERS; i++) {
+        stream_ctx_t *ctx = &stream_clients[i];
+        if (ctx->name && !ctx->tensor && ctx->peer_ip == ip) {
+            __atomic_store_n(&ctx->roi_req, packed, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+#endif  // STREAM_SENDER_H
@@ -0,0 +1,166 @@
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+#include "Arduino.h"
+#include "esp_timer.h"
+
+// 항상 켜두는 가벼운 성능 카운터.
+// 각 히스토그램은 한 태스크만 쓰므로 (캡처 태스크, 세션별 전송 태스크)
+// 쓰는 쪽에는 락이 없다. /stats 를 읽는 쪽은 약간 어긋난 값을 볼 수 있지만
+// 측정 대상의 타이밍은 바뀌지 않는다.
+
+// 2 의 거듭제곱 구간을 4 개씩 나눈 로그 히스토그램 (us 단위, 최대 약 33 초)
+#define STATS_HIST_BUCKETS 100
+// 롤링 윈도우 길이. 현재 윈도우 + 이전 윈도우를 합쳐서 보고한다.
+#define STATS_WINDOW_US 5000000LL
+
+typedef struct {
+    uint32_t count[STATS_HIST_BUCKETS];
+    uint32_t samples;
+    uint64_t amount;     // 함께 누적하는 양 (바이트 수 등)
+    int64_t start_us;
+    int64_t end_us;      // 이전 윈도우가 끝난 시각 (현재 윈도우는 0)
+} stats_window_t;
+
+typedef struct {
+    stats_window_t win[2];
+    int cur;
+} stats_hist_t;
+
+typedef struct {
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+    uint32_t samples;
+    float rate;          // 초당 샘플 수
+    float amount_rate;   // 초당 amount
+} stats_summary_t;
+
+static int stats_bucket(uint32_t v) {
+    if (v < 4) {
+        return v;
+    }
+    int msb = 31 - __builtin_clz(v);
+    int idx = (msb - 1) * 4 + ((v >> (msb - 2)) & 3);
+    return idx < STATS_HIST_BUCKETS ? idx : STATS_HIST_BUCKETS - 1;
+}
+
+// 버킷의 대표값 (구간의 가운데)
+static uint32_t stats_bucket_value(int idx) {
+    if (idx < 4) {
+        return idx;
+    }
+    int msb = idx / 4 + 1;
+    uint32_t lower = (uint32_t)(4 + idx % 4) << (msb - 2);
+    return lower + ((1u << (msb - 2)) >> 1);
+}
+
+void stats_hist_reset(stats_hist_t *h) {
+    memset(h, 0, sizeof(stats_hist_t));
+    h->win[0].start_us = esp_timer_get_time();
+}
+
+// 값 하나를 기록한다. 히스토그램마다 한 태스크에서만 호출해야 한다.
+void stats_hist_add(stats_hist_t *h, uint32_t value, uint32_t amount) {
+    int64_t now = esp_timer_get_time();
+    stats_window_t *w = &h->win[h->cur];
+
+    if (now - w->start_us >= STATS_WINDOW_US) {
+        // 윈도우 교체: 현재 윈도우를 이전으로 넘기고 오래된 윈도우를 비운다
+        w->end_us = now;
+        stats_window_t *next = &h->win[h->cur ^ 1];
+        memset(next->count, 0, sizeof(next->count));
+        next->samples = 0;
+        next->amount = 0;
+        next->end_us = 0;
+        next->start_us = now;
+        h->cur ^= 1;
+        w = next;
+    }
+    w->count[stats_bucket(value)]++;
+    w->samples++;
+    w->amount += amount;
+}
+
+// 두 윈도우를 합쳐 백분위수와 비율을 계산한다 (읽는 쪽)
+void stats_hist_summary(const stats_hist_t *h, stats_summary_t *out) {
+    uint32_t merged[STATS_HIST_BUCKETS];
+    int64_t now = esp_timer_get_time();
+    int64_t duration = 0;
+    uint64_t amount = 0;
+    uint32_t total = 0;
+
+    memset(out, 0, sizeof(stats_summary_t));
+    memset(merged, 0, sizeof(merged));
+    for (int w = 0; w < 2; w++) {
+        const stats_window_t *win = &h->win[w];
+        if (win->start_us == 0) {
+            continue;  // 아직 쓰이지 않은 윈도우
+        }
+        // 오래되어 의미 없는 이전 윈도우는 제외
+        int64_t end = (w == h->cur) ? now : win->end_us;
+        if (w != h->cur && now - end > STATS_WINDOW_US) {
+            continue;
+        }
+        for (int i = 0; i < STATS_HIST_BUCKETS; i++) {
+            merged[i] += win->count[i];
+        }
+        total += win->samples;
+        amount += win->amount;
+        duration += end - win->start_us;
+    }
+
+    out->samples = total;
+    if (duration > 0) {
+        out->rate = total * 1000000.0f / duration;
+        out->amount_rate = amount * 1000000.0f / duration;
+    }
+    if (total == 0) {
+        return;
+    }
+
+    uint32_t p50 = (total * 50 + 99) / 100;
+    uint32_t p95 = (total * 95 + 99) / 100;
+    uint32_t p99 = (total * 99 + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < STATS_HIST_BUCKETS; i++) {
+        if (merged[i] == 0) {
+            continue;
+        }
+        seen += merged[i];
+        uint32_t v = stats_bucket_value(i);
+        if (out->p50 == 0 && seen >= p50) out->p50 = v;
+        if (out->p95 == 0 && seen >= p95) out->p95 = v;
+        if (out->p99 == 0 && seen >= p99) {
+            out->p99 = v;
+            break;
+        }
+    }
+}
+
+// snprintf 가 돌려준 길이를 버퍼에 실제로 들어간 길이로 줄인다 (잘렸으면 len - 1).
+// /stats 의 JSON 함수들은 이 값을 돌려주므로 이어 쓰기 (buf + n, len - n) 와 청크 길이가 버퍼를 넘지 않는다.
+static inline int stats_json_fit(int n, size_t len) {
+    return n < 0 ? 0 : n < (int)len ? n : (int)len - 1;
+}
+
+// 요약을 JSON 객체로 쓴다. 쓴 길이를 돌려준다 (len 보다 작다).
+int stats_summary_json(char *buf, size_t len, const stats_hist_t *h) {
+    stats_summary_t s;
+    stats_hist_summary(h, &s);
+    return stats_json_fit(snprintf(buf, len, "{\"p50\":%u,\"p95\":%u,\"p99\":%u,\"n\":%u,\"rate\":%.1f}",
+                    (unsigned)s.p50, (unsigned)s.p95, (unsigned)s.p99, (unsigned)s.samples, s.rate), len);
+}
+
+// 캡처 태스크 카운터 (캡처 태스크만 쓴다)
+typedef struct {
+    uint32_t frames;
+    uint32_t failed;
+    stats_hist_t wait_us;       // esp_camera_fb_get() 에서 기다린 시간, amount = JPEG 바이트
+    stats_hist_t interval_us;   // 캡처 간격
+    int64_t last_us;
+} capture_stats_t;
+
+static capture_stats_t capture_stats;
+
+#endif  // STREAM_STATS_H
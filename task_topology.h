@@ -0,0 +1,144 @@
+#ifndef TASK_TOPOLOGY_H
+#define TASK_TOPOLOGY_H
+
+#include "Arduino.h"
+#include "esp_timer.h"
+
+// 태스크 배치. Wi-Fi/lwip 는 코어 0 에서 높은 우선순위로 돈다.
+// 제어 (httpd: /ws, /alt_ws 명령과 모터 I2C) 가 영상 작업보다 먼저 돌도록 우선순위를 가장 높게 두고,
+// 큰 JPEG 을 보내는 전송 태스크는 다른 코어 (0) 에 두어 제어 명령을 늦추지 않게 한다.
+// 모터 I2C 는 제어 명령을 받아 둔 모터 태스크 (motor_task.h) 가 캡처보다 먼저 보낸다.
+//   제어 (httpd)  : 코어 1, 우선순위 6
+//   모터          : 코어 1, 우선순위 5
+//   캡처          : 코어 1, 우선순위 4
+//   텔레메트리    : 코어 0, 우선순위 4 (짧은 메시지를 만들기만 하므로 전송보다 먼저)
+//   스트림 전송   : 코어 0, 우선순위 3
+//   로그 (Serial) : 코어 0, 우선순위 1 (log_ring.h)
+#define TASK_CORE_CONTROL 1
+#define TASK_PRIO_CONTROL 6
+#define TASK_CORE_MOTOR 1
+#define TASK_PRIO_MOTOR 5
+#define TASK_CORE_CAPTURE 1
+#define TASK_PRIO_CAPTURE 4
+#define TASK_CORE_TELEMETRY 0
+#define TASK_PRIO_TELEMETRY 4
+#define TASK_CORE_SENDER 0
+#define TASK_PRIO_SENDER 3
+#define TASK_CORE_LOG 0
+#define TASK_PRIO_LOG 1
+
+// 바쁜 시간을 스스로 재는 태스크 (FreeRTOS 실행 시간 통계가 꺼져 있을 때 CPU 점유율 대신 쓴다)
+#define TASK_MAX_TRACKED 8
+
+typedef struct {
+    TaskHandle_t handle;  // NULL 이면 빈 자리
+    int64_t start_us;     // 태스크를 만든 시각
+    int64_t busy_us;      // 태스크가 스스로 잰 일한 시간 (기다린 시간 제외)
+} task_track_t;
+
+static task_track_t task_tracks[TASK_MAX_TRACKED];
+static portMUX_TYPE task_track_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 정해진 코어와 우선순위로 태스크를 만들고 바쁜 시간 추적에 등록한다
+BaseType_t task_create(TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+                       UBaseType_t prio, BaseType_t core, TaskHandle_t *out) {
+    TaskHandle_t handle = NULL;
+    BaseType_t res = xTaskCreatePinnedToCore(fn, name, stack, param, prio, &handle, core);
+    if (res != pdPASS) {
+        Serial.printf("Failed to create task %s\n", name);
+        return res;
+    }
+    portENTER_CRITICAL(&task_track_lock);
+    for (int i = 0; i < TASK_MAX_TRACKED; i++) {
+        if (task_tracks[i].handle == NULL) {
+            task_tracks[i].handle = handle;
+            task_tracks[i].start_us = esp_timer_get_time();
+            task_tracks[i].busy_us = 0;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&task_track_lock);
+    if (out) {
+        *out = handle;
+    }
+    return res;
+}
+
+// 현재 태스크가 일한 시간을 더한다
+void task_busy_add(int64_t us) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < TASK_MAX_TRACKED; i++) {
+        if (task_tracks[i].handle == self) {
+            task_tracks[i].busy_us += us;  // 자기 항목은 자기만 쓴다
+            return;
+        }
+    }
+}
+
+// 스스로 끝나는 태스크가 vTaskDelete(NULL) 전에 호출한다
+void task_forget() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&task_track_lock);
+    for (int i = 0; i < TASK_MAX_TRACKED; i++) {
+        if (task_tracks[i].handle == self) {
+            task_tracks[i].handle = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&task_track_lock);
+}
+
+static const task_track_t *task_find_track(TaskHandle_t handle) {
+    for (int i = 0; i < TASK_MAX_TRACKED; i++) {
+        if (task_tracks[i].handle == handle) {
+            return &task_tracks[i];
+        }
+    }
+    return NULL;
+}
+
+typedef void (*task_report_fn_t)(void *arg, const char *json, int len);
+
+// 모든 태스크의 코어, 우선순위, 남은 스택 (high water mark, 바이트), CPU 점유율 (%) 을
+// JSON 객체로 하나씩 cb 에 넘긴다. CPU 점유율은 FreeRTOS 실행 시간 통계가 있으면
+// 부팅 이후 누적값, 없으면 task_create 로 만든 태스크만 스스로 잰 값 (나머지는 -1).
+// 태스크 수만큼 임시 버퍼를 쓰므로 /stats 처럼 가끔 부르는 곳에서만 쓴다.
+bool task_report(task_report_fn_t cb, void *arg) {
+    UBaseType_t count = uxTaskGetNumberOfTasks() + 2;  // 그 사이 생긴 태스크 여유분
+    TaskStatus_t *tasks = (TaskStatus_t *)malloc(count * sizeof(TaskStatus_t));
+    if (!tasks) {
+        return false;
+    }
+    uint32_t total_runtime = 0;
+    count = uxTaskGetSystemState(tasks, count, &total_runtime);
+    char buf[160];
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *t = &tasks[i];
+        float cpu = -1;
+#if configGENERATE_RUN_TIME_STATS
+        if (total_runtime > 0) {
+            // 두 코어를 합친 시간 대비 점유율
+            cpu = 100.0f * t->ulRunTimeCounter / total_runtime / portNUM_PROCESSORS;
+        }
+#else
+        const task_track_t *track = task_find_track(t->xHandle);
+        int64_t now = esp_timer_get_time();
+        if (track && now > track->start_us) {
+            cpu = 100.0f * track->busy_us / (now - track->start_us);
+        }
+#endif
+        int core = -1;
+#if configTASKLIST_INCLUDE_COREID
+        core = t->xCoreID < portNUM_PROCESSORS ? (int)t->xCoreID : -1;  // -1 = 코어 고정 없음
+#endif
+        // ESP-IDF 의 스택 단위는 바이트
+        int n = snprintf(buf, sizeof(buf), "{\"name\":\"%s\",\"core\":%d,\"prio\":%u,\"stack_free\":%u,\"cpu\":%.1f}",
+                         t->pcTaskName, core, (unsigned)t->uxCurrentPriority,
+                         (unsigned)t->usStackHighWaterMark, cpu);
+        cb(arg, buf, n);
+    }
+    free(tasks);
+    return true;
+}
+
+#endif  // TASK_TOPOLOGY_H
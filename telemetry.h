@@ -0,0 +1,270 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <WiFi.h>
+#include "Arduino.h"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "control_proto.h"
+#include "frame_share.h"
+#include "stream_stats.h"
+#include "motor_task.h"
+#include "task_topology.h"
+#include "log_ring.h"
+
+// 상태 푸시. PC 가 get_speed 를 계속 묻는 대신 /alt_ws 에서 한 번 구독하면
+// 텔레메트리 태스크가 정한 주기로 속도, 각도, 프레임 번호, 힙, RSSI, 루프 시간을 보낸다.
+//   {"cmd":"telemetry","state":"on","rate":10} -> JSON 텍스트 프레임
+//   바이너리 TELEMETRY (flags on, speed = Hz)  -> ctrl_telemetry_t 바이너리 프레임
+//   {"cmd":"telemetry","state":"off"}          -> 중지 (연결이 닫혀도 풀린다)
+//
+// 메시지는 텔레메트리 태스크가 만들고, 보내기는 httpd_queue_work 로 그 연결의 서버 태스크에서
+// httpd_ws_send_frame_async 로 한다. 같은 소켓에 get_speed 응답과 섞여 쓰이지 않게 하기 위해서다.
+// 앞 메시지가 아직 큐에 있으면 이번 주기는 건너뛴다 (skipped). 오래된 상태는 쌓지 않는다.
+// 큐에 있는 동안 구독이 풀리거나 같은 fd 번호가 새 연결에 다시 쓰일 수 있으므로, 보내기 직전에
+// 구독 세대 (gen) 와 그 fd 가 아직 WebSocket 인지 확인하고 아니면 버린다 (stale).
+
+#define TELEMETRY_MAX_SUBS 2
+#define TELEMETRY_MAX_HZ 50
+#define TELEMETRY_DEFAULT_HZ 10
+#define TELEMETRY_TICK_MS 10        // 1000 / TELEMETRY_MAX_HZ 이하
+#define TELEMETRY_MSG_MAX 192
+#define TELEMETRY_TASK_STACK 3072
+
+extern int car_angle;
+extern int car_speed;
+
+typedef struct {
+    httpd_handle_t server;      // NULL 이면 빈 자리
+    int fd;
+    uint32_t period_us;
+    int64_t next_us;
+    bool binary;
+    uint32_t seq;
+    uint32_t gen;               // 구독하거나 풀 때마다 1 씩 는다
+    // 아래는 큐에 넣은 보내기 작업이 쓴다. pending 동안 텔레메트리 태스크는 건드리지 않는다.
+    bool pending;
+    httpd_handle_t send_server;
+    int send_fd;
+    uint32_t send_gen;
+    bool send_binary;
+    int len;
+    uint8_t buf[TELEMETRY_MSG_MAX];
+} telemetry_sub_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t skipped;           // 앞 메시지를 아직 보내지 못해 건너뛴 주기
+    uint32_t errors;            // 보내기 실패 (구독을 푼다)
+    uint32_t stale;             // 큐에 있는 동안 구독이 바뀌어 버린 메시지
+} telemetry_stats_t;
+
+static telemetry_sub_t telemetry_subs[TELEMETRY_MAX_SUBS];
+static telemetry_stats_t telemetry_stats;
+static portMUX_TYPE telemetry_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t telemetry_task_handle = NULL;
+
+// 구독을 푼다. 보내는 중인 메시지는 그대로 끝난다.
+void telemetry_unsubscribe(httpd_handle_t server, int fd) {
+    portENTER_CRITICAL(&telemetry_lock);
+    for (int i = 0; i < TELEMETRY_MAX_SUBS; i++) {
+        if (telemetry_subs[i].server == server && telemetry_subs[i].fd == fd) {
+            telemetry_subs[i].server = NULL;
+            telemetry_subs[i].gen++;
+        }
+    }
+    portEXIT_CRITICAL(&telemetry_lock);
+}
+
+// 이 연결에 rate_hz 로 상태를 보낸다. 이미 구독 중이면 주기와 형식만 바꾼다. 자리가 없으면 false.
+bool telemetry_subscribe(httpd_handle_t server, int fd, int rate_hz, bool binary) {
+    rate_hz = constrain(rate_hz, 1, TELEMETRY_MAX_HZ);
+    int slot = -1;
+    portENTER_CRITICAL(&telemetry_lock);
+    for (int i = 0; i < TELEMETRY_MAX_SUBS; i++) {
+        telemetry_sub_t *t = &telemetry_subs[i];
+        if (t->server == server && t->fd == fd) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 && t->server == NULL) {
+            slot = i;
+        }
+    }
+    if (slot >= 0) {
+        telemetry_sub_t *t = &telemetry_subs[slot];
+        t->server = server;
+        t->fd = fd;
+        t->period_us = 1000000 / rate_hz;
+        t->next_us = 0;  // 바로 하나 보낸다
+        t->binary = binary;
+        t->gen++;
+    }
+    portEXIT_CRITICAL(&telemetry_lock);
+    if (slot < 0) {
+        LOG_W("telemetry: no free subscriber slot");
+        return false;
+    }
+    LOG_I("telemetry: fd %d at %d Hz (%s)", fd, rate_hz, binary ? "binary" : "json");
+    if (telemetry_task_handle) {
+        xTaskNotifyGive(telemetry_task_handle);  // 구독이 없어 잠들어 있으면 깨운다
+    }
+    return true;
+}
+
+// httpd 서버 태스크에서 돈다 (httpd_queue_work)
+static void telemetry_send_work(void *arg) {
+    telemetry_sub_t *t = (telemetry_sub_t *)arg;
+    portENTER_CRITICAL(&telemetry_lock);
+    bool current = t->gen == t->send_gen;
+    portEXIT_CRITICAL(&telemetry_lock);
+    if (!current || httpd_ws_get_fd_info(t->send_server, t->send_fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+        // 구독이 풀렸거나 fd 가 다른 연결로 넘어갔다
+        __atomic_add_fetch(&telemetry_stats.stale, 1, __ATOMIC_RELAXED);
+        if (current) {
+            telemetry_unsubscribe(t->send_server, t->send_fd);
+        }
+        __atomic_store_n(&t->pending, false, __ATOMIC_RELEASE);
+        return;
+    }
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.type = t->send_binary ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_TEXT;
+    frame.payload = t->buf;
+    frame.len = t->len;
+    frame.final = true;
+    esp_err_t ret = httpd_ws_send_frame_async(t->send_server, t->send_fd, &frame);
+    if (ret == ESP_OK) {
+        __atomic_add_fetch(&telemetry_stats.sent, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&telemetry_stats.errors, 1, __ATOMIC_RELAXED);
+        LOG_W("telemetry: send to fd %d failed (%d), unsubscribed", t->send_fd, ret);
+        telemetry_unsubscribe(t->send_server, t->send_fd);
+    }
+    __atomic_store_n(&t->pending, false, __ATOMIC_RELEASE);
+}
+
+// 이번 주기에 보낼 상태 (구독자 모두 같은 값)
+typedef struct {
+    int angle;
+    int speed;
+    uint32_t frame_seq;
+    uint32_t free_heap;
+    uint32_t capture_us;
+    uint32_t motor_us;
+    int rssi;
+} telemetry_state_t;
+
+static void telemetry_sample(telemetry_state_t *s) {
+    stats_summary_t sum;
+    s->angle = car_angle;
+    s->speed = car_speed;
+    s->frame_seq = frame_seq;
+    s->free_heap = esp_get_free_heap_size();
+    stats_hist_summary(&capture_stats.interval_us, &sum);
+    s->capture_us = sum.p50;
+    stats_hist_summary(&motor_stats.latency_us, &sum);
+    s->motor_us = sum.p50;
+    s->rssi = WiFi.RSSI();
+}
+
+static int telemetry_format(const telemetry_state_t *s, bool binary, uint32_t seq, uint8_t *buf, size_t len) {
+    if (binary) {
+        ctrl_telemetry_t msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.hdr.version = CTRL_PROTO_VERSION;
+        msg.hdr.opcode = CTRL_OP_TELEMETRY;
+        msg.hdr.seq = seq;
+        msg.hdr.angle = s->angle;
+        msg.hdr.speed = s->speed;
+        msg.frame_seq = s->frame_seq;
+        msg.free_heap = s->free_heap;
+        msg.capture_us = s->capture_us;
+        msg.motor_us = s->motor_us;
+        msg.rssi = s->rssi;
+        memcpy(buf, &msg, sizeof(msg));  // ESP32 는 little endian
+        return sizeof(msg);
+    }
+    int n = snprintf((char *)buf, len, "{\"seq\":%u,\"car_angle\":%d,\"car_speed\":%d,\"frame_seq\":%u,"
+                     "\"heap\":%u,\"rssi\":%d,\"capture_us\":%u,\"motor_us\":%u}",
+                     (unsigned)seq, s->angle, s->speed, (unsigned)s->frame_seq, (unsigned)s->free_heap,
+                     s->rssi, (unsigned)s->capture_us, (unsigned)s->motor_us);
+    return n < (int)len ? n : len - 1;
+}
+
+static void telemetry_task(void *param) {
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(TELEMETRY_TICK_MS));
+        int64_t now = esp_timer_get_time();
+        int64_t work_start = now;
+        bool sampled = false;
+        bool any = false;
+        telemetry_state_t state;
+
+        for (int i = 0; i < TELEMETRY_MAX_SUBS; i++) {
+            telemetry_sub_t *t = &telemetry_subs[i];
+            portENTER_CRITICAL(&telemetry_lock);
+            httpd_handle_t server = t->server;
+            int fd = t->fd;
+            bool binary = t->binary;
+            uint32_t gen = t->gen;
+            bool due = server && now >= t->next_us;
+            if (due) {
+                // 주기를 지키되, 많이 밀렸으면 (구독 직후 포함) 지금부터 다시 센다
+                t->next_us = now - t->next_us < t->period_us ? t->next_us + t->period_us : now + t->period_us;
+            }
+            portEXIT_CRITICAL(&telemetry_lock);
+            any = any || server;
+            if (!due) {
+                continue;
+            }
+            if (__atomic_load_n(&t->pending, __ATOMIC_ACQUIRE)) {
+                __atomic_add_fetch(&telemetry_stats.skipped, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+            if (!sampled) {
+                telemetry_sample(&state);
+                sampled = true;
+            }
+            t->send_server = server;
+            t->send_fd = fd;
+            t->send_gen = gen;
+            t->send_binary = binary;
+            t->len = telemetry_format(&state, binary, t->seq++, t->buf, sizeof(t->buf));
+            __atomic_store_n(&t->pending, true, __ATOMIC_RELEASE);
+            if (httpd_queue_work(server, telemetry_send_work, t) != ESP_OK) {
+                __atomic_store_n(&t->pending, false, __ATOMIC_RELEASE);
+                __atomic_add_fetch(&telemetry_stats.errors, 1, __ATOMIC_RELAXED);
+            }
+        }
+        task_busy_add(esp_timer_get_time() - work_start);
+
+        if (!any) {
+            // 구독자가 없으면 telemetry_subscribe 가 깨울 때까지 잔다
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            last_wake = xTaskGetTickCount();
+        }
+    }
+}
+
+void telemetry_init() {
+    memset(telemetry_subs, 0, sizeof(telemetry_subs));
+    memset(&telemetry_stats, 0, sizeof(telemetry_stats));
+    task_create(telemetry_task, "telemetry", TELEMETRY_TASK_STACK, NULL, TASK_PRIO_TELEMETRY, TASK_CORE_TELEMETRY,
+                &telemetry_task_handle);
+}
+
+// /stats 용 JSON
+int telemetry_stats_json(char *buf, size_t len) {
+    int subs = 0;
+    for (int i = 0; i < TELEMETRY_MAX_SUBS; i++) {
+        subs += telemetry_subs[i].server != NULL;
+    }
+    int n = snprintf(buf, len, "{\"subscribers\":%d,\"sent\":%u,\"skipped\":%u,\"errors\":%u,\"stale\":%u}", subs,
+                     (unsigned)telemetry_stats.sent, (unsigned)telemetry_stats.skipped,
+                     (unsigned)telemetry_stats.errors, (unsigned)telemetry_stats.stale);
+    return stats_json_fit(n, len);
+}
+
+#endif  // TELEMETRY_H
@@ -0,0 +1,127 @@
+#ifndef TENSOR_PREP_H
+#define TENSOR_PREP_H
+
+#include "Arduino.h"
+#include "esp_camera.h"
+#include "esp_jpg_decode.h"
+#include "lib/dl_lib.h"
+
+// PC 의 조향 모델에 바로 넣을 수 있는 작은 텐서를 차에서 만든다.
+// JPEG 를 축소 디코딩 (1/2, 1/4, 1/8) 하면서 디코더가 넘겨주는 블록에서
+// 필요한 화소만 골라 (최근접 보간) 출력 텐서에 바로 쓰므로 중간 RGB 버퍼가 없다.
+// 출력은 dl_matrix3du_t 와 같은 NHWC uint8 배열이다.
+
+#define TENSOR_MAX_SIZE 160
+
+typedef struct {
+    const uint8_t *jpg;
+    size_t jpg_len;
+    dl_matrix3du_t *out;
+    int src_w;              // 축소 디코딩된 이미지 크기
+    int src_h;
+    uint16_t map_x[TENSOR_MAX_SIZE];  // 출력 열 -> 원본 열
+    uint16_t map_y[TENSOR_MAX_SIZE];  // 출력 행 -> 원본 행
+} tensor_job_t;
+
+// esp_jpg_decode 의 작업 영역은 하나뿐이므로 변환은 한 번에 하나씩만 한다
+static SemaphoreHandle_t tensor_lock = NULL;
+static tensor_job_t tensor_job;
+
+void tensor_prep_init() {
+    tensor_lock = xSemaphoreCreateMutex();
+}
+
+static size_t tensor_jpg_read(void *arg, size_t index, uint8_t *buf, size_t len) {
+    tensor_job_t *job = (tensor_job_t *)arg;
+    if (index + len > job->jpg_len) {
+        len = job->jpg_len - index;
+    }
+    if (buf) {
+        memcpy(buf, job->jpg + index, len);
+    }
+    return len;
+}
+
+// RGB888 화소 하나를 출력 채널 수에 맞춰 쓴다
+static inline void tensor_put(uint8_t *dst, const uint8_t *rgb, int c) {
+    if (c == 1) {
+        // ITU-R BT.601 휘도 (정수 근사)
+        dst[0] = (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8;
+    } else {
+        dst[0] = rgb[0];
+        dst[1] = rgb[1];
+        dst[2] = rgb[2];
+    }
+}
+
+// 디코더가 블록 (MCU) 단위로 부르는 콜백. data 는 RGB888.
+static bool tensor_jpg_write(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data) {
+    tensor_job_t *job = (tensor_job_t *)arg;
+    dl_matrix3du_t *out = job->out;
+
+    if (!data) {
+        if (x == 0 && y == 0) {
+            // 시작: 축소된 이미지 크기를 알려준다. 출력 좌표 -> 원본 좌표 표를 만든다.
+            job->src_w = w;
+            job->src_h = h;
+            for (int ox = 0; ox < out->w; ox++) {
+                job->map_x[ox] = (ox * w + w / 2) / out->w;
+            }
+            for (int oy = 0; oy < out->h; oy++) {
+                job->map_y[oy] = (oy * h + h / 2) / out->h;
+            }
+        }
+        return true;
+    }
+
+    for (int oy = 0; oy < out->h; oy++) {
+        int sy = job->map_y[oy];
+        if (sy < y) {
+            continue;
+        }
+        if (sy >= y + h) {
+            break;
+        }
+        const uint8_t *row = data + (sy - y) * w * 3;
+        uint8_t *dst = out->item + oy * out->w * out->c;
+        for (int ox = 0; ox < out->w; ox++) {
+            int sx = job->map_x[ox];
+            if (sx < x) {
+                continue;
+            }
+            if (sx >= x + w) {
+                break;
+            }
+            tensor_put(dst + ox * out->c, row + (sx - x) * 3, out->c);
+        }
+    }
+    return true;
+}
+
+// JPEG 프레임을 out (w, h, c 가 정해진 NHWC 텐서) 으로 변환한다.
+// out 보다 작아지지 않는 범위에서 가장 많이 축소해서 디코딩한다.
+bool tensor_from_jpeg(const camera_fb_t *fb, dl_matrix3du_t *out) {
+    if (out->w > TENSOR_MAX_SIZE || out->h > TENSOR_MAX_SIZE || (out->c != 1 && out->c != 3)) {
+        return false;
+    }
+
+    jpg_scale_t scale = JPG_SCALE_NONE;
+    if ((int)(fb->width >> 3) >= out->w && (int)(fb->height >> 3) >= out->h) {
+        scale = JPG_SCALE_8X;
+    } else if ((int)(fb->width >> 2) >= out->w && (int)(fb->height >> 2) >= out->h) {
+        scale = JPG_SCALE_4X;
+    } else if ((int)(fb->width >> 1) >= out->w && (int)(fb->height >> 1) >= out->h) {
+        scale = JPG_SCALE_2X;
+    }
+
+    xSemaphoreTake(tensor_lock, portMAX_DELAY);
+    tensor_job.jpg = fb->buf;
+    tensor_job.jpg_len = fb->len;
+    tensor_job.out = out;
+    esp_err_t err = esp_jpg_decode(fb->len, scale, tensor_jpg_read, tensor_jpg_write, &tensor_job);
+    xSemaphoreGive(tensor_lock);
+
+    return err == ESP_OK;
+}
+
+#endif  // TENSOR_PREP_H
@@ -0,0 +1,59 @@
+#ifndef HOST_TEST_ALLOC_COUNT_H
+#define HOST_TEST_ALLOC_COUNT_H
+
+// malloc/calloc/realloc/free 를 가로채서 센다 (operator new/delete 도 malloc/free 를 거친다).
+// alloc_count_begin() 과 alloc_count_end() 사이에서 불린 힙 연산 수를 돌려준다.
+// glibc 전용 (__libc_malloc). 세는 동안에는 printf 처럼 버퍼를 잡을 수 있는 호출을 하지 않는다.
+
+#include <stdlib.h>
+#include <atomic>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+}
+
+static std::atomic<bool> alloc_counting(false);
+static std::atomic<long> alloc_calls(0);
+
+static inline void alloc_note() {
+    if (alloc_counting.load(std::memory_order_relaxed)) {
+        alloc_calls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+extern "C" void *malloc(size_t size) throw() {
+    alloc_note();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) throw() {
+    alloc_note();
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) throw() {
+    alloc_note();
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void *p) throw() {
+    if (p) {
+        alloc_note();
+    }
+    __libc_free(p);
+}
+
+static inline void alloc_count_begin() {
+    alloc_calls = 0;
+    alloc_counting = true;
+}
+
+static inline long alloc_count_end() {
+    alloc_counting = false;
+    return alloc_calls.load();
+}
+
+#endif  // HOST_TEST_ALLOC_COUNT_H
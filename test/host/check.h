@@ -0,0 +1,34 @@
+#ifndef HOST_TEST_CHECK_H
+#define HOST_TEST_CHECK_H
+
+// 호스트 테스트용 아주 작은 검사 매크로. 실패하면 위치를 찍고 세기만 한다.
+
+#include <stdio.h>
+
+static int check_failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);      \
+            check_failures++;                                                    \
+        }                                                                        \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                           \
+    do {                                                                         \
+        long long _a = (long long)(a), _b = (long long)(b);                      \
+        if (_a != _b) {                                                          \
+            printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__,   \
+                   __LINE__, #a, #b, _a, _b);                                    \
+            check_failures++;                                                    \
+        }                                                                        \
+    } while (0)
+
+// main 의 마지막에서 부른다
+static int check_report(const char *name) {
+    printf("%s: %s\n", name, check_failures ? "FAILED" : "ok");
+    return check_failures ? 1 : 0;
+}
+
+#endif  // HOST_TEST_CHECK_H
@@ -0,0 +1,58 @@
+#pragma once
+
+// Arduino-ESP32 코어 중 테스트하는 헤더들이 쓰는 것만 흉내 낸다.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+
+#include "freertos_stub.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"  // 장치에서도 Arduino.h 를 거쳐 들어온다
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_TIMEOUT 0x107
+
+struct StubSerial {
+    void print(const char *s) { fputs(s, stdout); }
+    void println(const char *s = "") { puts(s); }
+    int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vprintf(fmt, ap);
+        va_end(ap);
+        return n;
+    }
+};
+static StubSerial Serial;
+
+struct StubEsp {
+    // 240 MHz 로 센 것처럼 돌려준다
+    uint32_t getCycleCount() {
+        using namespace std::chrono;
+        return (uint32_t)(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() * 240 / 1000);
+    }
+};
+static StubEsp ESP;
+
+static inline unsigned long millis() { return (unsigned long)(esp_timer_get_time() / 1000); }
+static inline void delay(uint32_t ms) { vTaskDelay(ms); }
+static inline uint32_t esp_random() { return (uint32_t)rand(); }
+static inline uint32_t esp_get_free_heap_size() { return 200000; }
+static inline bool psramFound() { return true; }
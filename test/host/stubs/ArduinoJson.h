@@ -0,0 +1,157 @@
+#pragma once
+
+// ArduinoJson 중 명령 표가 쓰는 부분만: doc["key"] = 값, doc["key"] | 기본값, deserializeJson.
+// deserializeJson 은 문자열 / 정수 / true, false 값만 있는 평평한 객체만 읽는다.
+
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+
+class JsonDocument {
+public:
+    struct Value {
+        bool is_str = false;
+        bool is_int = false;
+        std::string str;
+        long num = 0;
+    };
+
+    class Ref {
+    public:
+        Ref(JsonDocument *doc, const std::string &key) : doc_(doc), key_(key) {}
+        Ref &operator=(const char *s) {
+            Value &v = doc_->values_[key_];
+            v.is_str = true;
+            v.str = s;
+            return *this;
+        }
+        Ref &operator=(long n) {
+            Value &v = doc_->values_[key_];
+            v.is_int = true;
+            v.num = n;
+            return *this;
+        }
+        Ref &operator=(int n) { return *this = (long)n; }
+        const char *operator|(const char *def) const {
+            auto it = doc_->values_.find(key_);
+            return it != doc_->values_.end() && it->second.is_str ? it->second.str.c_str() : def;
+        }
+        int operator|(int def) const {
+            auto it = doc_->values_.find(key_);
+            return it != doc_->values_.end() && it->second.is_int ? (int)it->second.num : def;
+        }
+
+    private:
+        JsonDocument *doc_;
+        std::string key_;
+    };
+
+    Ref operator[](const char *key) { return Ref(this, key); }
+    void clear() { values_.clear(); }
+
+private:
+    std::map<std::string, Value> values_;
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument {};
+
+class DeserializationError {
+public:
+    enum Code { Ok, EmptyInput, InvalidInput };
+
+    DeserializationError(Code code = Ok) : code_(code) {}
+    explicit operator bool() const { return code_ != Ok; }
+    Code code() const { return code_; }
+    const char *c_str() const {
+        static const char *names[] = { "Ok", "EmptyInput", "InvalidInput" };
+        return names[code_];
+    }
+
+private:
+    Code code_;
+};
+
+namespace stub_json {
+
+static inline const char *skip_ws(const char *p) {
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    return p;
+}
+
+// "..." 를 읽어 out 에 넣고 닫는 따옴표 다음을 돌려준다. 실패하면 NULL.
+static inline const char *parse_string(const char *p, std::string *out) {
+    if (*p++ != '"') {
+        return NULL;
+    }
+    out->clear();
+    while (*p && *p != '"') {
+        if (*p == '\\') {
+            p++;
+            if (!*p) {
+                return NULL;
+            }
+        }
+        out->push_back(*p++);
+    }
+    return *p == '"' ? p + 1 : NULL;
+}
+
+}  // namespace stub_json
+
+static inline DeserializationError deserializeJson(JsonDocument &doc, const char *input) {
+    using namespace stub_json;
+    doc.clear();
+    const char *p = skip_ws(input);
+    if (!*p) {
+        return DeserializationError::EmptyInput;
+    }
+    if (*p++ != '{') {
+        return DeserializationError::InvalidInput;
+    }
+    p = skip_ws(p);
+    if (*p == '}') {
+        return DeserializationError::Ok;
+    }
+    std::string key, str;
+    while (true) {
+        p = parse_string(skip_ws(p), &key);
+        if (!p) {
+            return DeserializationError::InvalidInput;
+        }
+        p = skip_ws(p);
+        if (*p++ != ':') {
+            return DeserializationError::InvalidInput;
+        }
+        p = skip_ws(p);
+        if (*p == '"') {
+            p = parse_string(p, &str);
+            if (!p) {
+                return DeserializationError::InvalidInput;
+            }
+            doc[key.c_str()] = str.c_str();
+        } else if (!strncmp(p, "true", 4) || !strncmp(p, "false", 5)) {
+            doc[key.c_str()] = *p == 't' ? 1 : 0;
+            p += *p == 't' ? 4 : 5;
+        } else {
+            char *end;
+            long n = strtol(p, &end, 10);
+            if (end == p) {
+                return DeserializationError::InvalidInput;
+            }
+            doc[key.c_str()] = n;
+            p = end;
+        }
+        p = skip_ws(p);
+        if (*p == '}') {
+            return DeserializationError::Ok;
+        }
+        if (*p++ != ',') {
+            return DeserializationError::InvalidInput;
+        }
+    }
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+struct StubWiFi {
+    int RSSI() { return -55; }
+};
+static StubWiFi WiFi;
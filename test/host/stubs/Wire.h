@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// 모터 드라이버로 가는 I2C 바이트를 세기만 한다
+struct StubWire {
+    uint32_t bytes = 0;
+    void begin(int, int) {}
+    void beginTransmission(uint8_t) {}
+    void write(uint8_t) { bytes++; }
+    uint8_t endTransmission() { return 0; }
+};
+static StubWire Wire;
@@ -0,0 +1,119 @@
+#pragma once
+
+// esp32-camera 의 자료형 (순서와 값은 원본과 같다) 과 버퍼 반환 감시
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <functional>
+
+#include "Arduino.h"
+
+typedef enum {
+    PIXFORMAT_RGB565,
+    PIXFORMAT_YUV422,
+    PIXFORMAT_YUV420,
+    PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG,
+    PIXFORMAT_RGB888,
+    PIXFORMAT_RAW,
+    PIXFORMAT_RGB444,
+    PIXFORMAT_RGB555,
+} pixformat_t;
+
+typedef enum {
+    FRAMESIZE_96X96,    // 96x96
+    FRAMESIZE_QQVGA,    // 160x120
+    FRAMESIZE_QCIF,     // 176x144
+    FRAMESIZE_HQVGA,    // 240x176
+    FRAMESIZE_240X240,  // 240x240
+    FRAMESIZE_QVGA,     // 320x240
+    FRAMESIZE_CIF,      // 400x296
+    FRAMESIZE_HVGA,     // 480x320
+    FRAMESIZE_VGA,      // 640x480
+    FRAMESIZE_SVGA,     // 800x600
+    FRAMESIZE_XGA,      // 1024x768
+    FRAMESIZE_HD,       // 1280x720
+    FRAMESIZE_SXGA,     // 1280x1024
+    FRAMESIZE_UXGA,     // 1600x1200
+    FRAMESIZE_INVALID
+} framesize_t;
+
+typedef enum {
+    ASPECT_RATIO_4X3,
+    ASPECT_RATIO_3X2,
+    ASPECT_RATIO_16X10,
+    ASPECT_RATIO_5X3,
+    ASPECT_RATIO_16X9,
+    ASPECT_RATIO_21X9,
+    ASPECT_RATIO_5X4,
+    ASPECT_RATIO_1X1,
+    ASPECT_RATIO_9X16
+} aspect_ratio_t;
+
+typedef struct {
+    const uint16_t width;
+    const uint16_t height;
+    const aspect_ratio_t aspect_ratio;
+} resolution_info_t;
+
+static const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+    {   96,   96, ASPECT_RATIO_1X1   },
+    {  160,  120, ASPECT_RATIO_4X3   },
+    {  176,  144, ASPECT_RATIO_5X4   },
+    {  240,  176, ASPECT_RATIO_3X2   },
+    {  240,  240, ASPECT_RATIO_1X1   },
+    {  320,  240, ASPECT_RATIO_4X3   },
+    {  400,  296, ASPECT_RATIO_4X3   },
+    {  480,  320, ASPECT_RATIO_3X2   },
+    {  640,  480, ASPECT_RATIO_4X3   },
+    {  800,  600, ASPECT_RATIO_4X3   },
+    { 1024,  768, ASPECT_RATIO_4X3   },
+    { 1280,  720, ASPECT_RATIO_16X9  },
+    { 1280, 1024, ASPECT_RATIO_5X4   },
+    { 1600, 1200, ASPECT_RATIO_4X3   },
+};
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+    struct timeval timestamp;
+} camera_fb_t;
+
+typedef struct {
+    framesize_t framesize;
+    uint8_t quality;
+} camera_status_t;
+
+typedef struct _sensor sensor_t;
+struct _sensor {
+    camera_status_t status;
+    int (*set_framesize)(sensor_t *sensor, framesize_t framesize);
+    int (*set_quality)(sensor_t *sensor, int quality);
+};
+
+static int stub_set_framesize(sensor_t *s, framesize_t size) {
+    s->status.framesize = size;
+    return 0;
+}
+static int stub_set_quality(sensor_t *s, int quality) {
+    s->status.quality = quality;
+    return 0;
+}
+static sensor_t stub_sensor = { { FRAMESIZE_QVGA, 10 }, stub_set_framesize, stub_set_quality };
+
+static inline sensor_t *esp_camera_sensor_get() { return &stub_sensor; }
+
+// 테스트가 정하는 버퍼 공급 / 반환 감시
+static std::function<camera_fb_t *()> stub_fb_get;
+static std::function<void(camera_fb_t *)> stub_fb_return;
+
+static inline camera_fb_t *esp_camera_fb_get() { return stub_fb_get ? stub_fb_get() : NULL; }
+static inline void esp_camera_fb_return(camera_fb_t *fb) {
+    if (stub_fb_return) {
+        stub_fb_return(fb);
+    }
+}
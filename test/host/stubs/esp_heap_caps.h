@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+static inline void *heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+static inline void *heap_caps_calloc(size_t n, size_t size, uint32_t) { return calloc(n, size); }
+static inline void heap_caps_free(void *p) { free(p); }
+static inline size_t heap_caps_get_free_size(uint32_t) { return 4 * 1024 * 1024; }
+static inline size_t heap_caps_get_largest_free_block(uint32_t) { return 4 * 1024 * 1024; }
@@ -0,0 +1,147 @@
+#pragma once
+
+// esp_http_server 중 테스트하는 헤더들이 쓰는 자료형과 함수. 서버는 없고
+// 보낸 WebSocket 프레임과 닫힌 세션만 기록한다.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+#include "Arduino.h"
+
+typedef void *httpd_handle_t;
+typedef void (*httpd_work_fn_t)(void *arg);
+
+typedef enum {
+    HTTP_GET = 1,
+    HTTP_POST = 3,
+} httpd_method_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    const char uri[64];
+    size_t content_len;
+    void *aux;
+    void *user_ctx;
+    void *sess_ctx;
+    void (*free_ctx)(void *ctx);
+    int fd;                    // 스텁 전용: httpd_req_to_sockfd 가 돌려준다
+} httpd_req_t;
+
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT = 0x1,
+    HTTPD_WS_TYPE_BINARY = 0x2,
+    HTTPD_WS_TYPE_CLOSE = 0x8,
+    HTTPD_WS_TYPE_PING = 0x9,
+    HTTPD_WS_TYPE_PONG = 0xA,
+} httpd_ws_type_t;
+
+typedef enum {
+    HTTPD_WS_CLIENT_INVALID = 0x0,
+    HTTPD_WS_CLIENT_HTTP = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET = 0x2,
+} httpd_ws_client_info_t;
+
+typedef struct httpd_ws_frame {
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t *payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+    bool is_websocket;
+    bool handle_ws_control_frames;
+    const char *supported_subprotocol;
+} httpd_uri_t;
+
+typedef enum {
+    HTTPD_400_BAD_REQUEST = 400,
+    HTTPD_404_NOT_FOUND = 404,
+    HTTPD_500_INTERNAL_SERVER_ERROR = 500,
+} httpd_err_code_t;
+
+#define HTTPD_RESP_USE_STRLEN -1
+
+// 스텁이 기록하는 것
+struct stub_ws_sent {
+    httpd_handle_t server;
+    int fd;
+    httpd_ws_type_t type;
+    std::vector<uint8_t> payload;
+};
+static std::vector<stub_ws_sent> stub_ws_log;
+static std::vector<int> stub_closed_fds;   // 여러 전송 태스크가 닫으므로 stub_closed_lock 으로 지킨다
+static std::mutex stub_closed_lock;
+static httpd_ws_client_info_t stub_fd_info = HTTPD_WS_CLIENT_WEBSOCKET;
+static esp_err_t stub_ws_send_result = ESP_OK;
+
+// httpd_ws_recv_frame 이 돌려줄 다음 프레임 (테스트가 정한다) 과 페이로드를 읽은 횟수
+static const uint8_t *stub_ws_rx_data;
+static size_t stub_ws_rx_len;
+static httpd_ws_type_t stub_ws_rx_type = HTTPD_WS_TYPE_TEXT;
+static int stub_ws_rx_reads;
+
+static inline int httpd_req_to_sockfd(httpd_req_t *r) { return r->fd; }
+
+static inline esp_err_t httpd_queue_work(httpd_handle_t, httpd_work_fn_t work, void *arg) {
+    work(arg);  // 서버 태스크 대신 바로 실행한다
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame) {
+    if (stub_ws_send_result == ESP_OK) {
+        stub_ws_log.push_back({ hd, fd, frame->type,
+                                std::vector<uint8_t>(frame->payload, frame->payload + frame->len) });
+    }
+    return stub_ws_send_result;
+}
+
+static inline esp_err_t httpd_ws_send_frame(httpd_req_t *r, httpd_ws_frame_t *frame) {
+    return httpd_ws_send_frame_async(r->handle, r->fd, frame);
+}
+
+// max_len 이 0 이면 길이와 종류만, 아니면 max_len 바이트까지 frame->payload 에 복사한다
+static inline esp_err_t httpd_ws_recv_frame(httpd_req_t *, httpd_ws_frame_t *frame, size_t max_len) {
+    if (max_len == 0) {
+        frame->len = stub_ws_rx_len;
+        frame->type = stub_ws_rx_type;
+        return ESP_OK;
+    }
+    if (!stub_ws_rx_len || !frame->payload) {
+        frame->len = 0;
+        return ESP_FAIL;
+    }
+    frame->len = max_len < stub_ws_rx_len ? max_len : stub_ws_rx_len;
+    memcpy(frame->payload, stub_ws_rx_data, frame->len);
+    stub_ws_rx_reads++;
+    return ESP_OK;
+}
+
+static inline httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t, int) { return stub_fd_info; }
+
+static inline esp_err_t httpd_sess_trigger_close(httpd_handle_t, int fd) {
+    std::lock_guard<std::mutex> lk(stub_closed_lock);
+    stub_closed_fds.push_back(fd);
+    return ESP_OK;
+}
+
+static inline esp_err_t httpd_resp_send(httpd_req_t *, const char *, ssize_t) { return ESP_OK; }
+static inline esp_err_t httpd_resp_send_chunk(httpd_req_t *, const char *, ssize_t) { return ESP_OK; }
+static inline esp_err_t httpd_resp_send_500(httpd_req_t *) { return ESP_FAIL; }
+static inline esp_err_t httpd_resp_send_err(httpd_req_t *, httpd_err_code_t, const char *) { return ESP_FAIL; }
+static inline esp_err_t httpd_resp_set_status(httpd_req_t *, const char *) { return ESP_OK; }
+static inline esp_err_t httpd_resp_set_type(httpd_req_t *, const char *) { return ESP_OK; }
+static inline esp_err_t httpd_resp_set_hdr(httpd_req_t *, const char *, const char *) { return ESP_OK; }
+static inline esp_err_t httpd_req_get_url_query_str(httpd_req_t *, char *, size_t) { return ESP_FAIL; }
+static inline esp_err_t httpd_query_key_value(const char *, const char *, char *, size_t) { return ESP_FAIL; }
+static inline esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *, const char *, char *, size_t) { return ESP_FAIL; }
@@ -0,0 +1,28 @@
+#pragma once
+
+// esp32-camera 의 esp_jpg_decode 자리. 실제 JPEG 을 푸는 대신 테스트가 stub_jpg_decode 로
+// 블록 단위 RGB888 을 writer 에 넘긴다 (디코더처럼 MCU 순서, 줄 단위 블록).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+#include "Arduino.h"
+
+typedef enum {
+    JPG_SCALE_NONE,
+    JPG_SCALE_2X,
+    JPG_SCALE_4X,
+    JPG_SCALE_8X,
+    JPG_SCALE_MAX = JPG_SCALE_8X
+} jpg_scale_t;
+
+typedef size_t (*jpg_reader_cb)(void *arg, size_t index, uint8_t *buf, size_t len);
+typedef bool (*jpg_writer_cb)(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data);
+
+static std::function<esp_err_t(size_t, jpg_scale_t, jpg_reader_cb, jpg_writer_cb, void *)> stub_jpg_decode;
+
+static inline esp_err_t esp_jpg_decode(size_t len, jpg_scale_t scale, jpg_reader_cb reader, jpg_writer_cb writer,
+                                       void *arg) {
+    return stub_jpg_decode ? stub_jpg_decode(len, scale, reader, writer, arg) : ESP_FAIL;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+// 테스트가 stub_now_us 를 0 이상으로 두면 그 값을 현재 시각으로 쓴다 (가짜 시계)
+static int64_t stub_now_us = -1;
+
+static inline int64_t esp_timer_get_time() {
+    if (stub_now_us >= 0) {
+        return stub_now_us;
+    }
+    using namespace std::chrono;
+    static const steady_clock::time_point boot = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - boot).count();
+}
@@ -0,0 +1,179 @@
+#ifndef HOST_STUB_FREERTOS_H
+#define HOST_STUB_FREERTOS_H
+
+// FreeRTOS 를 std::thread 와 std::mutex 로 흉내 낸다. 1 tick = 1 ms.
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define portMAX_DELAY 0xffffffffu
+#define portNUM_PROCESSORS 2
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configGENERATE_RUN_TIME_STATS 0
+#define configTASKLIST_INCLUDE_COREID 0
+
+static inline bool stub_wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lk, TickType_t ticks,
+                             const std::function<bool()> &ready) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lk, ready);
+        return true;
+    }
+    return cv.wait_for(lk, std::chrono::milliseconds(ticks), ready);
+}
+
+struct stub_sem {
+    std::mutex m;
+    std::condition_variable cv;
+    int count;
+    int max;
+};
+typedef stub_sem *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t stub_sem_create(int count, int max) {
+    stub_sem *s = new stub_sem;
+    s->count = count;
+    s->max = max;
+    return s;
+}
+#define xSemaphoreCreateMutex() stub_sem_create(1, 1)
+#define xSemaphoreCreateBinary() stub_sem_create(0, 1)
+#define xSemaphoreCreateCounting(max, init) stub_sem_create(init, max)
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+    std::unique_lock<std::mutex> lk(s->m);
+    if (!stub_wait(s->cv, lk, ticks, [s] { return s->count > 0; })) {
+        return pdFALSE;
+    }
+    s->count--;
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+    std::lock_guard<std::mutex> lk(s->m);
+    if (s->count >= s->max) {
+        return pdFALSE;
+    }
+    s->count++;
+    s->cv.notify_one();
+    return pdTRUE;
+}
+
+typedef struct {
+    std::recursive_mutex m;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->m.lock()
+#define portEXIT_CRITICAL(mux) (mux)->m.unlock()
+
+struct stub_queue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    size_t item_size;
+    size_t max;
+};
+typedef stub_queue *QueueHandle_t;
+
+static inline QueueHandle_t xQueueCreate(size_t len, size_t item_size) {
+    stub_queue *q = new stub_queue;
+    q->item_size = item_size;
+    q->max = len;
+    return q;
+}
+
+static inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lk(q->m);
+    if (!stub_wait(q->cv, lk, ticks, [q] { return q->items.size() < q->max; })) {
+        return pdFALSE;
+    }
+    const uint8_t *p = (const uint8_t *)item;
+    q->items.emplace_back(p, p + q->item_size);
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+static inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lk(q->m);
+    if (!stub_wait(q->cv, lk, ticks, [q] { return !q->items.empty(); })) {
+        return pdFALSE;
+    }
+    memcpy(item, q->items.front().data(), q->item_size);
+    q->items.pop_front();
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+static inline TickType_t xTaskGetTickCount() {
+    using namespace std::chrono;
+    return (TickType_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+static inline void vTaskDelayUntil(TickType_t *last, TickType_t ticks) {
+    *last += ticks;
+    int32_t wait = (int32_t)(*last - xTaskGetTickCount());
+    if (wait > 0) {
+        vTaskDelay(wait);
+    }
+}
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local char self;
+    return &self;
+}
+
+// 태스크는 분리된 스레드로 돌린다. 테스트가 끝나면 프로세스와 함께 사라진다.
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *, uint32_t, void *param,
+                                                 UBaseType_t, TaskHandle_t *out, BaseType_t) {
+    static char handles[64];
+    static int next = 0;
+    std::thread(fn, param).detach();
+    if (out) {
+        *out = &handles[next++ % 64];
+    }
+    return pdPASS;
+}
+
+static inline void vTaskDelete(TaskHandle_t) {}
+static inline void xTaskNotifyGive(TaskHandle_t) {}
+static inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t ticks) {
+    vTaskDelay(ticks == portMAX_DELAY ? 10 : ticks);
+    return 0;
+}
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t uxCurrentPriority;
+    uint32_t usStackHighWaterMark;
+    uint32_t ulRunTimeCounter;
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+static inline UBaseType_t uxTaskGetNumberOfTasks() { return 0; }
+static inline UBaseType_t uxTaskGetSystemState(TaskStatus_t *, UBaseType_t, uint32_t *total) {
+    *total = 0;
+    return 0;
+}
+
+#endif  // HOST_STUB_FREERTOS_H
@@ -0,0 +1,33 @@
+#pragma once
+
+// esp32-camera 의 인코더 자리. 넘겨받은 화소를 그대로 출력으로 흘려 보낸다 (압축하지 않음).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_camera.h"
+
+typedef size_t (*jpg_out_cb)(void *arg, size_t index, const void *data, size_t len);
+
+static pixformat_t stub_jpg_format;
+static int stub_jpg_w, stub_jpg_h;
+
+static inline bool fmt2jpg_cb(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format,
+                              uint8_t quality, jpg_out_cb cb, void *arg) {
+    stub_jpg_format = format;
+    stub_jpg_w = width;
+    stub_jpg_h = height;
+    return cb(arg, 0, src, src_len) == src_len;
+}
+
+static inline bool fmt2jpg(uint8_t *src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format,
+                           uint8_t quality, uint8_t **out, size_t *out_len) {
+    *out = (uint8_t *)malloc(src_len);
+    memcpy(*out, src, src_len);
+    *out_len = src_len;
+    return true;
+}
+
+static inline bool fmt2rgb888(const uint8_t *src, size_t src_len, pixformat_t format, uint8_t *rgb_buf) {
+    return false;
+}
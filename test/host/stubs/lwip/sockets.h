@@ -0,0 +1,17 @@
+#pragma once
+
+// lwip 의 BSD 소켓 이름을 호스트 소켓으로 돌린다
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define lwip_select select
+#define lwip_sendmsg sendmsg
+#define lwip_socket socket
+#define lwip_close close
+#define lwip_getpeername getpeername
+#define lwip_setsockopt setsockopt
@@ -0,0 +1,137 @@
+// adaptive_quality.h : 단계표가 4:3 해상도만 쓰는지, 대역폭 기록에서 단계가 수렴하는지 시험한다.
+
+#include "../../adaptive_quality.h"
+#include "check.h"
+
+// 단계별 프레임 크기 모형: 화소당 바이트가 품질 숫자에 반비례한다 (QVGA q10 약 15 KB)
+static float frame_bytes(const adapt_config_t *cfg, int level) {
+    const resolution_info_t *r = &resolution[adapt_level_framesize(cfg, level)];
+    return r->width * r->height * (2.0f / adapt_level_quality(cfg, level));
+}
+
+static void test_ladder() {
+    adapt_state_t st;
+    adapt_state_init(&adapt_config, &st, 0);
+    CHECK_EQ(st.levels, 2 * 5);  // QVGA, QQVGA x 품질 10..30
+    framesize_t prev = adapt_level_framesize(&adapt_config, 0);
+    CHECK_EQ(prev, FRAMESIZE_QVGA);
+    for (int level = 0; level < st.levels; level++) {
+        framesize_t size = adapt_level_framesize(&adapt_config, level);
+        CHECK(size == FRAMESIZE_QVGA || size == FRAMESIZE_QQVGA);
+        CHECK_EQ(resolution[size].width * 3, resolution[size].height * 4);
+        CHECK(size <= prev);
+        CHECK(adapt_level_quality(&adapt_config, level) >= adapt_config.quality_best);
+        CHECK(adapt_level_quality(&adapt_config, level) <= adapt_config.quality_worst);
+        // 단계가 내려갈수록 프레임이 작아진다 (화질 순서가 맞다)
+        if (level > 0) {
+            CHECK(frame_bytes(&adapt_config, level) < frame_bytes(&adapt_config, level - 1));
+        }
+        prev = size;
+    }
+    CHECK_EQ(adapt_level_framesize(&adapt_config, st.levels - 1), FRAMESIZE_QQVGA);
+
+    // 더 큰 시작 해상도는 4:3 크기만 거친다 (SVGA -> VGA -> QVGA -> QQVGA)
+    adapt_config_t big = adapt_config;
+    big.size_max = FRAMESIZE_SVGA;
+    adapt_state_init(&big, &st, 0);
+    CHECK_EQ(st.levels, 4 * 5);
+    for (int level = 0; level < st.levels; level++) {
+        framesize_t size = adapt_level_framesize(&big, level);
+        CHECK_EQ(resolution[size].width * 3, resolution[size].height * 4);
+    }
+
+    // 4:3 이 아닌 시작 해상도는 그보다 작은 4:3 크기에서 시작한다
+    adapt_init(FRAMESIZE_CIF, 10);
+    CHECK_EQ(adapt_config.size_max, FRAMESIZE_QVGA);
+    adapt_init(FRAMESIZE_HQVGA, 10);
+    CHECK_EQ(adapt_config.size_max, FRAMESIZE_QQVGA);
+    adapt_init(FRAMESIZE_QVGA, 10);
+}
+
+// 1 초 윈도우마다 링크 대역폭 (바이트/초) 으로 추정 FPS 를 만들어 제어기에 넣는다
+static int run_trace(adapt_state_t *st, float bandwidth, int windows, int *changes_at_end) {
+    int changes_before = st->changes;
+    int tail_start = 0;
+    for (int w = 0; w < windows; w++) {
+        float est_fps = bandwidth / frame_bytes(&adapt_config, st->level);
+        if (w == windows - 10) {
+            tail_start = st->changes;
+        }
+        adapt_step(&adapt_config, st, est_fps);
+    }
+    *changes_at_end = st->changes - tail_start;
+    return st->changes - changes_before;
+}
+
+static void test_convergence() {
+    adapt_state_t st;
+    adapt_state_init(&adapt_config, &st, 0);
+    float lo = adapt_config.target_fps * (1 - adapt_config.hysteresis);
+    int tail = 0;
+
+    // 넉넉한 링크: 최고 단계 유지
+    CHECK_EQ(run_trace(&st, 400000, 20, &tail), 0);
+    CHECK_EQ(st.level, 0);
+
+    // 대역폭이 크게 줄면 목표 FPS 를 낼 수 있는 단계까지 내려가서 멈춘다
+    run_trace(&st, 60000, 40, &tail);
+    CHECK_EQ(tail, 0);
+    CHECK(60000 / frame_bytes(&adapt_config, st.level) >= lo);
+    CHECK(st.level > 0 && 60000 / frame_bytes(&adapt_config, st.level - 1) < lo);
+    printf("  60 KB/s -> level %d (%s q%d, %.1f fps)\n", st.level,
+           adapt_level_framesize(&adapt_config, st.level) == FRAMESIZE_QVGA ? "QVGA" : "QQVGA",
+           adapt_level_quality(&adapt_config, st.level), 60000 / frame_bytes(&adapt_config, st.level));
+
+    // 어떤 단계로도 목표를 못 내면 가장 낮은 단계에 머문다
+    run_trace(&st, 5000, 40, &tail);
+    CHECK_EQ(st.level, st.levels - 1);
+    CHECK_EQ(tail, 0);
+
+    // 회복하면 다시 올라간다 (위로는 천천히)
+    run_trace(&st, 400000, 60, &tail);
+    CHECK_EQ(st.level, 0);
+    CHECK_EQ(tail, 0);
+
+    // 히스테리시스 구간 근처의 흔들리는 대역폭에서 진동하지 않는다
+    adapt_state_init(&adapt_config, &st, 0);
+    run_trace(&st, 100000, 30, &tail);
+    int settled = st.level;
+    uint32_t changes = st.changes;
+    for (int w = 0; w < 200; w++) {
+        float jitter = (w % 3 == 0 ? 0.9f : w % 3 == 1 ? 1.1f : 1.0f);
+        adapt_step(&adapt_config, &st, 100000 * jitter / frame_bytes(&adapt_config, st.level));
+    }
+    CHECK_EQ(st.changes, changes);
+    CHECK_EQ(st.level, settled);
+}
+
+// 캡처 태스크 경로: 윈도우마다 센서 해상도와 품질을 바꾼다
+static void test_tick() {
+    adapt_init(FRAMESIZE_QVGA, 10);
+    sensor_t *s = esp_camera_sensor_get();
+    s->status.framesize = FRAMESIZE_QVGA;
+    stub_now_us = 1;
+    adapt_window_start = 0;
+    adapt_tick();
+    for (int w = 0; w < 40; w++) {
+        // 프레임당 200 ms (5 fps) 걸리는 링크
+        for (int f = 0; f < 5; f++) {
+            adapt_observe(200000, 15000);
+        }
+        stub_now_us += adapt_config.window_us;
+        adapt_tick();
+        CHECK(s->status.framesize == FRAMESIZE_QVGA || s->status.framesize == FRAMESIZE_QQVGA);
+    }
+    CHECK_EQ(adapt_state.level, adapt_state.levels - 1);
+    CHECK_EQ(s->status.framesize, FRAMESIZE_QQVGA);
+    CHECK_EQ(s->status.quality, adapt_config.quality_worst);
+    stub_now_us = -1;
+}
+
+int main() {
+    log_init();
+    test_ladder();
+    test_convergence();
+    test_tick();
+    return check_report("adaptive");
+}
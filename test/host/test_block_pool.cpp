@@ -0,0 +1,134 @@
+// block_pool.h : 크기 클래스 선택, 빈 블록 리스트, 힙 대체 할당, 여러 스레드에서의 할당/해제를 시험한다.
+
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../../block_pool.h"
+#include "check.h"
+
+static bool in_pool(const block_pool_t *pool, void *p) {
+    return (uint8_t *)p >= pool->base && (uint8_t *)p < pool->base + pool->blocks * pool->block_size;
+}
+
+static int free_list_len(const block_pool_t *pool) {
+    int n = 0;
+    for (void *b = pool->free_head; b; b = *(void **)b) {
+        CHECK(in_pool(pool, b));
+        if (++n > pool->blocks) {
+            break;  // 순환
+        }
+    }
+    return n;
+}
+
+static void test_classes() {
+    block_pool_t *small = &block_pools[0];
+    block_pool_t *large = &block_pools[1];
+    void *a = block_alloc(1);
+    void *b = block_alloc(POOL_SMALL_SIZE);
+    void *c = block_alloc(POOL_SMALL_SIZE + 1);
+    void *d = block_alloc(POOL_LARGE_SIZE + 1);
+    CHECK(in_pool(small, a) && in_pool(small, b));
+    CHECK(in_pool(large, c));
+    CHECK(d && !in_pool(small, d) && !in_pool(large, d));
+    CHECK_EQ(small->used, 2);
+    CHECK_EQ(large->used, 1);
+    CHECK_EQ(large->fallbacks, 1);  // 어느 클래스에도 맞지 않음
+
+    // 블록끼리 겹치지 않는다
+    memset(a, 0xAA, POOL_SMALL_SIZE);
+    memset(b, 0xBB, POOL_SMALL_SIZE);
+    CHECK_EQ(((uint8_t *)a)[POOL_SMALL_SIZE - 1], 0xAA);
+    CHECK(b != a);
+
+    block_free(b);
+    block_free(a);
+    block_free(c);
+    block_free(d);
+    block_free(NULL);
+    CHECK_EQ(small->used, 0);
+    CHECK_EQ(large->used, 0);
+    CHECK_EQ(small->peak, 2);
+    // 마지막에 돌려받은 블록을 먼저 준다
+    CHECK(block_alloc(10) == a);
+    block_free(a);
+}
+
+// 풀이 비면 더 큰 클래스를 쓰지 않고 힙에서 받는다
+static void test_exhaust() {
+    block_pool_t *small = &block_pools[0];
+    block_pool_t *large = &block_pools[1];
+    std::vector<void *> got;
+    std::set<void *> unique;
+    for (int i = 0; i < small->blocks; i++) {
+        got.push_back(block_alloc(64));
+        CHECK(in_pool(small, got.back()));
+        unique.insert(got.back());
+    }
+    CHECK_EQ(unique.size(), small->blocks);
+    CHECK(small->free_head == NULL);
+    uint32_t fallbacks = small->fallbacks;
+    void *extra = block_alloc(64);
+    CHECK(extra && !in_pool(small, extra) && !in_pool(large, extra));
+    CHECK_EQ(small->fallbacks, fallbacks + 1);
+    CHECK_EQ(large->used, 0);
+    block_free(extra);
+    for (void *p : got) {
+        block_free(p);
+    }
+    CHECK_EQ(small->used, 0);
+    CHECK_EQ(free_list_len(small), small->blocks);
+}
+
+// 여러 스레드가 섞어서 할당/해제해도 블록을 잃거나 두 번 주지 않는다
+static void test_threads() {
+    std::vector<std::thread> threads;
+    std::atomic<int> overlap(0);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([t, &overlap] {
+            std::mt19937 rng(t);
+            std::vector<std::pair<uint8_t *, size_t>> held;
+            for (int i = 0; i < 20000; i++) {
+                if (held.size() < 8 && rng() % 2) {
+                    size_t size = rng() % 3 == 0 ? 1000 + rng() % 30000 : 1 + rng() % POOL_SMALL_SIZE;
+                    uint8_t *p = (uint8_t *)block_alloc(size);
+                    memset(p, t + 1, size);
+                    held.push_back({ p, size });
+                } else if (!held.empty()) {
+                    size_t k = rng() % held.size();
+                    uint8_t *p = held[k].first;
+                    for (size_t j = 0; j < held[k].second; j += 97) {
+                        overlap += p[j] != t + 1;  // 다른 스레드가 같은 블록을 받았다
+                    }
+                    block_free(p);
+                    held.erase(held.begin() + k);
+                }
+            }
+            for (auto &h : held) {
+                block_free(h.first);
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    CHECK_EQ(overlap, 0);
+    for (int i = 0; i < POOL_CLASSES; i++) {
+        CHECK_EQ(block_pools[i].used, 0);
+        CHECK_EQ(free_list_len(&block_pools[i]), block_pools[i].blocks);
+        printf("  %s: %u allocs, %u fallbacks, peak %d of %d\n", block_pools[i].name,
+               (unsigned)block_pools[i].allocs, (unsigned)block_pools[i].fallbacks, block_pools[i].peak,
+               block_pools[i].blocks);
+    }
+}
+
+int main() {
+    block_pool_init();
+    test_classes();
+    test_exhaust();
+    test_threads();
+    return check_report("block_pool");
+}
@@ -0,0 +1,248 @@
+// ctrl_dispatch.h : 명령 해시 표의 등록, 엔드포인트별 호출, 충돌 칸 찾기를 시험한다.
+// 명령 하나를 찾아 부르는 데 드는 시간과, 받은 메시지를 JSON / 바이너리로 처리하는 데 드는 시간도 잰다.
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../../ctrl_dispatch.h"
+#include "check.h"
+
+static int calls[CMD_EP_COUNT][8];
+static cmd_args_t last;
+
+#define CMD_FN(i)                                                                       \
+    static void cmd_fn_##i(const cmd_args_t *a) {                                       \
+        calls[a->ep][i]++;                                                              \
+        last = *a;                                                                      \
+    }
+CMD_FN(0)
+CMD_FN(1)
+CMD_FN(2)
+CMD_FN(3)
+CMD_FN(4)
+CMD_FN(5)
+CMD_FN(6)
+
+static void register_all() {
+    cmd_table_init();
+    CMD_REGISTER("move", CMD_EP_MASK(CMD_EP_HP) | CMD_EP_MASK(CMD_EP_PC), cmd_fn_1);
+    CMD_REGISTER("stop", CMD_EP_MASK(CMD_EP_HP) | CMD_EP_MASK(CMD_EP_PC), cmd_fn_2);
+    CMD_REGISTER("led", CMD_EP_MASK(CMD_EP_HP) | CMD_EP_MASK(CMD_EP_PC), cmd_fn_3);
+    CMD_REGISTER("set_speed", CMD_EP_MASK(CMD_EP_PC), cmd_fn_4);
+    CMD_REGISTER("get_speed", CMD_EP_MASK(CMD_EP_PC), cmd_fn_5);
+    CMD_REGISTER("telemetry", CMD_EP_MASK(CMD_EP_PC), cmd_fn_6);
+    CMD_REGISTER("roi", CMD_EP_MASK(CMD_EP_PC), cmd_fn_0);
+}
+
+static void test_table() {
+    memset(calls, 0, sizeof(calls));
+    register_all();
+    CHECK_EQ(cmd_count, 7);
+    CHECK_EQ(CMD_HASH("set_speed"), cmd_hash(std::string("set_speed").c_str()));
+
+    JsonDocument doc;
+    doc["cmd"] = "move";
+    doc["angle"] = 20;
+    doc["speed"] = 150;
+    CHECK(cmd_dispatch_json(NULL, CMD_EP_PC, &doc));
+    CHECK_EQ(calls[CMD_EP_PC][1], 1);
+    CHECK(last.angle == 20 && last.speed == 150 && last.doc == &doc && last.bin == NULL);
+    CHECK_EQ(strcmp(last.state, ""), 0);
+
+    // /ws 에는 set_speed 가 없다
+    doc["cmd"] = "set_speed";
+    CHECK(!cmd_dispatch_json(NULL, CMD_EP_HP, &doc));
+    CHECK(cmd_dispatch_json(NULL, CMD_EP_PC, &doc));
+    doc["cmd"] = "fly";
+    CHECK(!cmd_dispatch_json(NULL, CMD_EP_PC, &doc));
+    doc.clear();
+    CHECK(!cmd_dispatch_json(NULL, CMD_EP_PC, &doc));  // cmd 없음
+    CHECK_EQ(cmd_unknown, 3);
+
+    // 바이너리 opcode 는 같은 표의 같은 함수로 간다
+    ctrl_msg_t msg = { CTRL_PROTO_VERSION, CTRL_OP_LED, CTRL_FLAG_ON, 7, 0, 0 };
+    CHECK(cmd_dispatch_binary(NULL, CMD_EP_HP, &msg));
+    CHECK_EQ(calls[CMD_EP_HP][3], 1);
+    CHECK(last.bin == &msg && last.doc == NULL && strcmp(last.state, "on") == 0);
+    msg.opcode = CTRL_OP_TELEMETRY;
+    CHECK(cmd_dispatch_binary(NULL, CMD_EP_PC, &msg));
+    CHECK_EQ(calls[CMD_EP_PC][6], 1);
+    msg.opcode = 0;
+    CHECK(!cmd_dispatch_binary(NULL, CMD_EP_PC, &msg));
+    msg.opcode = 99;
+    CHECK(!cmd_dispatch_binary(NULL, CMD_EP_PC, &msg));
+    CHECK_EQ(cmd_unknown, 5);
+
+    // 다시 등록하면 그 엔드포인트의 함수만 바뀐다
+    CMD_REGISTER("move", CMD_EP_MASK(CMD_EP_HP), cmd_fn_0);
+    CHECK_EQ(cmd_count, 7);
+    doc["cmd"] = "move";
+    cmd_dispatch_json(NULL, CMD_EP_HP, &doc);
+    cmd_dispatch_json(NULL, CMD_EP_PC, &doc);
+    CHECK_EQ(calls[CMD_EP_HP][0], 1);
+    CHECK_EQ(calls[CMD_EP_PC][1], 2);
+    CHECK(cmd_probe_max <= 3);
+}
+
+// 같은 칸에 떨어지는 이름 n 개 (slot_of 와 같은 칸)
+static std::vector<std::string> colliding_names(const char *slot_of, int n) {
+    std::vector<std::string> names;
+    uint32_t slot = cmd_hash(slot_of) & (CMD_SLOTS - 1);
+    for (int i = 0; (int)names.size() < n; i++) {
+        std::string name = "c" + std::to_string(i);
+        if ((cmd_hash(name.c_str()) & (CMD_SLOTS - 1)) == slot) {
+            names.push_back(name);
+        }
+    }
+    return names;
+}
+
+// 같은 칸에 떨어지는 이름이 많아도 모두 찾고, CMD_MAX 를 넘으면 등록을 거절한다
+static void test_collisions() {
+    cmd_table_init();
+    std::vector<std::string> names = colliding_names("move", 6);
+    names.reserve(CMD_MAX);
+    for (int i = 0; i < CMD_MAX; i++) {
+        if (i < (int)names.size()) {
+            CHECK(cmd_register(cmd_hash(names[i].c_str()), names[i].c_str(), CMD_EP_MASK(CMD_EP_PC), cmd_fn_1));
+        } else {
+            names.push_back("x" + std::to_string(i));
+            CHECK(cmd_register(cmd_hash(names[i].c_str()), names[i].c_str(), CMD_EP_MASK(CMD_EP_PC), cmd_fn_2));
+        }
+    }
+    CHECK(!cmd_register(cmd_hash("one_too_many"), "one_too_many", CMD_EP_MASK(CMD_EP_PC), cmd_fn_1));
+    cmd_args_t args;
+    memset(&args, 0, sizeof(args));
+    args.ep = CMD_EP_PC;
+    for (const std::string &n : names) {
+        CHECK(cmd_dispatch(cmd_hash(n.c_str()), n.c_str(), &args));
+    }
+    CHECK(!cmd_dispatch(cmd_hash("move"), "move", &args));  // 같은 칸, 없는 이름
+    printf("  %d commands, 6 in one slot: probe_max %d\n", CMD_MAX, cmd_probe_max);
+}
+
+// 명령 하나를 표에서 찾아 부르는 데 드는 시간 (해시 포함). 등록된 명령 수 4, 8, 16 에서
+// 절반은 한 칸에 몰리게 해서 평균 (모든 이름을 돌아가며) 과 가장 나쁜 경우 (가장 많은 칸을 보는 이름) 를 잰다.
+static void bench_dispatch() {
+    const int sizes[] = { 4, 8, CMD_MAX };
+    for (int size : sizes) {
+        cmd_table_init();
+        // 표는 이름 포인터를 그대로 쥐므로 재할당되지 않게 한 번에 만든다
+        std::vector<std::string> names = colliding_names("move", size / 2);
+        for (int i = 0; (int)names.size() < size; i++) {
+            names.push_back("cmd" + std::to_string(i));
+        }
+        for (const std::string &n : names) {
+            CHECK(cmd_register(cmd_hash(n.c_str()), n.c_str(), CMD_EP_MASK(CMD_EP_PC), cmd_fn_1));
+        }
+        CHECK_EQ(cmd_count, size);
+
+        cmd_args_t args;
+        memset(&args, 0, sizeof(args));
+        args.ep = CMD_EP_PC;
+        const int n = 1000000;
+        int found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            const char *name = names[i % size].c_str();
+            found += cmd_dispatch(cmd_hash(name), name, &args);
+        }
+        double avg_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+        CHECK_EQ(found, n);
+
+        // 가장 많은 칸을 보는 이름
+        const char *worst = NULL;
+        int worst_probes = 0;
+        for (const std::string &name : names) {
+            cmd_probe_max = 0;
+            cmd_find(cmd_hash(name.c_str()), name.c_str());
+            if (cmd_probe_max > worst_probes) {
+                worst_probes = cmd_probe_max;
+                worst = name.c_str();
+            }
+        }
+        found = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            found += cmd_dispatch(cmd_hash(worst), worst, &args);
+        }
+        double worst_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+        CHECK_EQ(found, n);
+
+        printf("  %2d commands (%d in one slot): %.0f ns per call, %.0f ns for %s (%d probes)\n",
+               size, size / 2, avg_ns, worst_ns, worst, worst_probes);
+    }
+}
+
+// 받은 메시지 하나를 명령 함수까지 보내는 비용. 제어 WebSocket 핸들러와 같은 순서로 한다.
+//   JSON   : 텍스트 -> deserializeJson -> cmd_dispatch_json
+//   바이너리 : 12 바이트 -> ctrl_parse -> cmd_dispatch_binary
+// 스텁의 JsonDocument 는 std::map 이라 JSON 쪽 절대값은 장치의 ArduinoJson 과 다르다. 두 경로의 차이만 본다.
+static void bench_paths() {
+    register_all();
+    memset(calls, 0, sizeof(calls));
+    char text[] = "{\"cmd\":\"move\",\"angle\":-30,\"speed\":200}";
+    ctrl_msg_t src = { CTRL_PROTO_VERSION, CTRL_OP_MOVE, 0, 1, -30, 200 };
+    uint8_t wire[sizeof(ctrl_msg_t)];
+    memcpy(wire, &src, sizeof(wire));
+    const int n = 200000;
+
+    int json_errors = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        StaticJsonDocument<256> doc;
+        if (deserializeJson(doc, text)) {
+            json_errors++;
+            continue;
+        }
+        cmd_dispatch_json(NULL, CMD_EP_PC, &doc);
+    }
+    double json_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    CHECK_EQ(json_errors, 0);
+    CHECK_EQ(calls[CMD_EP_PC][1], n);
+    CHECK(last.angle == -30 && last.speed == 200);
+
+    int bin_errors = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        ctrl_msg_t msg;
+        if (!ctrl_parse(wire, sizeof(wire), &msg)) {
+            bin_errors++;
+            continue;
+        }
+        cmd_dispatch_binary(NULL, CMD_EP_PC, &msg);
+    }
+    double bin_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    CHECK_EQ(bin_errors, 0);
+    CHECK_EQ(calls[CMD_EP_PC][1], 2 * n);
+    CHECK(last.angle == -30 && last.speed == 200);
+
+    printf("  JSON   (%d bytes): %.0f ns per message on this host\n", (int)strlen(text), json_ns);
+    printf("  binary (%d bytes): %.0f ns per message on this host\n", (int)sizeof(wire), bin_ns);
+}
+
+// 스텁의 deserializeJson 이 핸들러가 받는 형태를 읽고, 깨진 입력은 거절하는지
+static void test_deserialize() {
+    StaticJsonDocument<256> doc;
+    CHECK(!deserializeJson(doc, " { \"cmd\" : \"led\", \"state\":\"on\", \"on\":true, \"angle\":-5 } "));
+    CHECK_EQ(strcmp(doc["cmd"] | "", "led"), 0);
+    CHECK_EQ(strcmp(doc["state"] | "", "on"), 0);
+    CHECK_EQ(doc["on"] | 0, 1);
+    CHECK_EQ(doc["angle"] | 0, -5);
+    CHECK_EQ(doc["speed"] | 7, 7);
+    CHECK(!deserializeJson(doc, "{}"));
+    CHECK_EQ(deserializeJson(doc, "").code(), DeserializationError::EmptyInput);
+    CHECK_EQ(deserializeJson(doc, "{\"cmd\":}").code(), DeserializationError::InvalidInput);
+    CHECK_EQ(deserializeJson(doc, "{\"cmd\":\"move\"").code(), DeserializationError::InvalidInput);
+    CHECK_EQ(deserializeJson(doc, "[1]").code(), DeserializationError::InvalidInput);
+}
+
+int main() {
+    test_table();
+    test_collisions();
+    test_deserialize();
+    bench_dispatch();
+    bench_paths();
+    return check_report("cmd_table");
+}
@@ -0,0 +1,44 @@
+// control_proto.h : 바이너리 제어 메시지의 길이/버전 검사, 필드 해석, GET_SPEED 응답을 시험한다.
+
+#include "../../control_proto.h"
+#include "check.h"
+
+static void test_parse() {
+    CHECK_EQ(sizeof(ctrl_msg_t), 12);
+    CHECK_EQ(sizeof(ctrl_telemetry_t), 32);
+
+    // version 1, MOVE, flags 1, seq 0x01020304, angle -30, speed 200 (little endian)
+    const uint8_t wire[] = { 1, 1, 0x01, 0x00, 0x04, 0x03, 0x02, 0x01, 0xE2, 0xFF, 0xC8, 0x00, 0xEE, 0xEE };
+    ctrl_msg_t msg = {};
+    CHECK(ctrl_parse(wire, 12, &msg));
+    CHECK_EQ(msg.version, 1);
+    CHECK_EQ(msg.opcode, CTRL_OP_MOVE);
+    CHECK_EQ(msg.flags, CTRL_FLAG_ON);
+    CHECK_EQ(msg.seq, 0x01020304);
+    CHECK_EQ(msg.angle, -30);
+    CHECK_EQ(msg.speed, 200);
+    CHECK(ctrl_parse(wire, sizeof(wire), &msg));  // 뒤에 필드가 늘어난 메시지도 받는다
+    CHECK(!ctrl_parse(wire, 11, &msg));
+    uint8_t v2[12];
+    memcpy(v2, wire, 12);
+    v2[0] = 2;
+    CHECK(!ctrl_parse(v2, 12, &msg));
+
+    // GET_SPEED 응답은 받은 seq 와 현재 값을 담은 12 바이트 바이너리 프레임
+    httpd_req_t req = {};
+    req.fd = 42;
+    stub_ws_log.clear();
+    msg.opcode = CTRL_OP_GET_SPEED;
+    CHECK_EQ(ctrl_send_reply(&req, &msg, 15, 180), ESP_OK);
+    CHECK_EQ(stub_ws_log.size(), 1);
+    CHECK_EQ(stub_ws_log[0].type, HTTPD_WS_TYPE_BINARY);
+    CHECK_EQ(stub_ws_log[0].payload.size(), 12);
+    ctrl_msg_t reply = {};
+    CHECK(ctrl_parse(stub_ws_log[0].payload.data(), 12, &reply));
+    CHECK(reply.opcode == CTRL_OP_GET_SPEED && reply.seq == msg.seq && reply.angle == 15 && reply.speed == 180);
+}
+
+int main() {
+    test_parse();
+    return check_report("ctrl_proto");
+}
@@ -0,0 +1,193 @@
+// frame_share.h : 참조 카운트로 프레임 하나를 여러 구독자에게 나눠 주는지 시험한다.
+// 카메라 버퍼는 fb_count 개뿐이고, 마지막 참조가 풀릴 때 정확히 한 번 반환되어야 한다.
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include "../../frame_share.h"
+#include "check.h"
+
+#define FB_COUNT 3
+
+static camera_fb_t fbs[FB_COUNT];
+static std::atomic<int> fb_out[FB_COUNT];     // 드라이버 밖에 나와 있으면 1
+static std::atomic<int> bad_returns(0);       // 나와 있지 않은 버퍼를 반환
+static std::atomic<int> returns(0);
+static std::mutex pool_lock;
+static std::condition_variable pool_cv;
+
+static int fb_index(camera_fb_t *fb) { return (int)(fb - fbs); }
+
+static void pool_init() {
+    for (int i = 0; i < FB_COUNT; i++) {
+        fb_out[i] = 0;
+    }
+    bad_returns = 0;
+    returns = 0;
+    stub_fb_return = [](camera_fb_t *fb) {
+        std::lock_guard<std::mutex> lk(pool_lock);
+        if (fb_out[fb_index(fb)].exchange(0) != 1) {
+            bad_returns++;
+        }
+        returns++;
+        pool_cv.notify_all();
+    };
+}
+
+// 드라이버처럼 빈 버퍼가 생길 때까지 기다린다
+static camera_fb_t *pool_get(uint32_t seq) {
+    std::unique_lock<std::mutex> lk(pool_lock);
+    while (true) {
+        for (int i = 0; i < FB_COUNT; i++) {
+            if (fb_out[i] == 0) {
+                fb_out[i] = 1;
+                fbs[i].len = 1000 + seq;
+                fbs[i].timestamp.tv_sec = seq;
+                return &fbs[i];
+            }
+        }
+        pool_cv.wait(lk);
+    }
+}
+
+static void share_init() {
+    camera_fb_count = FB_COUNT;
+    frame_share_init();
+    pool_init();
+}
+
+// 게시 참조가 넘어가도 읽고 있는 참조가 모두 풀릴 때까지 버퍼를 돌려주지 않는다
+static void test_refcount() {
+    share_init();
+    camera_fb_t *a = pool_get(1);
+    CHECK_EQ(frame_publish(a), 1);
+    frame_ref_t *r[3];
+    for (int i = 0; i < 3; i++) {
+        r[i] = frame_acquire();
+        CHECK(r[i] && r[i]->fb == a && r[i]->seq == 1);
+    }
+    CHECK_EQ(frame_publish(pool_get(2)), 2);
+    CHECK_EQ(returns, 0);
+    frame_release(r[0]);
+    frame_release(r[1]);
+    CHECK_EQ(returns, 0);
+    CHECK_EQ(fb_out[fb_index(a)], 1);
+    frame_release(r[2]);
+    CHECK_EQ(returns, 1);
+    CHECK_EQ(fb_out[fb_index(a)], 0);
+
+    frame_ref_t *latest = frame_acquire();
+    CHECK(latest && latest->seq == 2);
+    frame_release(latest);
+    CHECK_EQ(frame_publish(NULL), 0);  // 게시 취소
+    CHECK(frame_acquire() == NULL);
+    CHECK_EQ(returns, 2);
+    CHECK_EQ(bad_returns, 0);
+}
+
+// 모든 슬롯을 클라이언트가 잡고 있으면 새 프레임은 바로 반환하고 버린다
+static void test_ring_full() {
+    share_init();
+    frame_ref_t *held[FB_COUNT];
+    for (int i = 0; i < FB_COUNT; i++) {
+        frame_publish(pool_get(i + 1));
+        held[i] = frame_acquire();
+    }
+    camera_fb_t extra;
+    memset(&extra, 0, sizeof(extra));
+    std::function<void(camera_fb_t *)> saved = stub_fb_return;
+    bool extra_returned = false;
+    stub_fb_return = [&](camera_fb_t *fb) {
+        if (fb == &extra) {
+            extra_returned = true;
+        } else {
+            saved(fb);
+        }
+    };
+    CHECK_EQ(frame_publish(&extra), 0);  // 버린 프레임은 번호를 받지 않는다
+    CHECK(extra_returned);
+    frame_ref_t *latest = frame_acquire();
+    CHECK(latest && latest->seq == FB_COUNT);  // 이전 프레임이 그대로 게시되어 있다
+    frame_release(latest);
+    stub_fb_return = saved;
+    for (int i = 0; i < FB_COUNT; i++) {
+        frame_release(held[i]);
+    }
+    frame_publish(NULL);
+    CHECK_EQ(returns, FB_COUNT);
+    CHECK_EQ(bad_returns, 0);
+}
+
+// 캡처 스레드 하나와 속도가 다른 구독자 N 개. 버퍼는 한 번씩만, 잡혀 있지 않을 때만 반환된다.
+static void test_fan_out(int subscribers) {
+    share_init();
+    const uint32_t frames = 3000;
+    std::atomic<bool> done(false);
+    std::atomic<int> use_after_return(0);
+    std::vector<uint32_t> seen(subscribers, 0);
+    std::vector<std::thread> threads;
+
+    for (int s = 0; s < subscribers; s++) {
+        threads.emplace_back([&, s] {
+            int sub = frame_subscribe();
+            CHECK(sub >= 0);
+            std::mt19937 rng(s);
+            uint32_t last = 0;
+            while (!done) {
+                frame_ref_t *f = frame_wait(sub, last, 20);
+                if (!f) {
+                    continue;
+                }
+                CHECK((int32_t)(f->seq - last) > 0);
+                last = f->seq;
+                int idx = fb_index(f->fb);
+                if (fb_out[idx] != 1 || f->fb->len != 1000 + f->seq) {
+                    use_after_return++;
+                }
+                // 구독자마다 보내는 데 걸리는 시간이 다르다 (s = 0 이 가장 빠름)
+                if (rng() % 4 < (unsigned)s) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(rng() % (200 * (s + 1))));
+                }
+                if (fb_out[idx] != 1 || f->fb->len != 1000 + f->seq) {
+                    use_after_return++;
+                }
+                frame_release(f);
+                seen[s]++;
+            }
+            frame_unsubscribe(sub);
+        });
+    }
+
+    for (uint32_t i = 1; i <= frames; i++) {
+        frame_publish(pool_get(i));
+        if (i % 8 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    done = true;
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    frame_publish(NULL);
+
+    CHECK_EQ(use_after_return, 0);
+    CHECK_EQ(bad_returns, 0);
+    CHECK_EQ(returns, frames);  // 게시한 버퍼는 모두 정확히 한 번 반환되었다
+    for (int i = 0; i < FB_COUNT; i++) {
+        CHECK_EQ(fb_out[i], 0);
+    }
+    for (int s = 0; s < subscribers; s++) {
+        CHECK(seen[s] > 0);
+        printf("  %d subscribers: #%d got %u of %u frames\n", subscribers, s, seen[s], frames);
+    }
+}
+
+int main() {
+    test_refcount();
+    test_ring_full();
+    test_fan_out(1);
+    test_fan_out(FRAME_MAX_SUBSCRIBERS);
+    return check_report("frame_share");
+}
@@ -0,0 +1,149 @@
+// log_ring.h : 여러 생산자 스레드와 한 소비자로 링을 돌려 빠짐/중복이 없는지, 가득 찼을 때
+// 버린 수를 세는지, 줄 형식이 맞는지 시험한다. LOG_x 한 번의 비용도 잰다.
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../../log_ring.h"
+#include "check.h"
+
+static const char *names[] = { "stream", "ws", "udp" };
+
+// 형식, 수준 글자, 시각, 문자열 인자, 긴 줄 자르기
+static void test_format() {
+    log_init();
+    stub_now_us = 12345678;
+    LOG_W("sender %s evicted after %u ms", names[1], 1500u);
+    LOG_E("no args");
+    LOG_D("debug is compiled out at LOG_LEVEL_INFO");
+    LOG_I("%d %d %d %d %d %d", 1, -2, 3, -4, 5, -6);
+    static const char long_fmt[] =
+        "0123456789012345678901234567890123456789012345678901234567890123456789"
+        "0123456789012345678901234567890123456789012345678901234567890123456789"
+        "0123456789012345678901234567890123456789";
+    LOG_I(long_fmt);
+    stub_now_us = -1;
+
+    char line[LOG_LINE_MAX];
+    CHECK(log_pop_line(line, sizeof(line)));
+    CHECK_EQ(strcmp(line, "   12.345 W sender ws evicted after 1500 ms\n"), 0);
+    CHECK(log_pop_line(line, sizeof(line)));
+    CHECK_EQ(strcmp(line, "   12.345 E no args\n"), 0);
+    CHECK(log_pop_line(line, sizeof(line)));
+    CHECK_EQ(strcmp(line, "   12.345 I 1 -2 3 -4 5 -6\n"), 0);
+    CHECK(log_pop_line(line, sizeof(line)));
+    CHECK_EQ(strlen(line), LOG_LINE_MAX - 1);
+    CHECK_EQ(line[LOG_LINE_MAX - 2], '\n');
+    CHECK(!log_pop_line(line, sizeof(line)));
+}
+
+// 소비자가 없으면 LOG_SLOTS 개까지 받고 나머지는 버린 수로 센다
+static void test_full() {
+    log_init();
+    uint32_t dropped = log_dropped;
+    for (unsigned i = 0; i < LOG_SLOTS + 10; i++) {
+        LOG_I("event %u", i);
+    }
+    CHECK_EQ(log_dropped - dropped, 10);
+    char line[LOG_LINE_MAX];
+    unsigned got = 0;
+    while (log_pop_line(line, sizeof(line))) {
+        unsigned sec, ms, n;
+        CHECK_EQ(sscanf(line, "%u.%u I event %u", &sec, &ms, &n), 3);
+        CHECK_EQ(n, got);
+        got++;
+    }
+    CHECK_EQ(got, LOG_SLOTS);
+    LOG_I("event %u", 999u);  // 비운 뒤에는 다시 받는다
+    CHECK(log_pop_line(line, sizeof(line)));
+}
+
+// 생산자 여럿 + 소비자 하나: 받은 것과 버린 것의 합이 쓴 수와 같고, 생산자마다 순서가 지켜진다
+static void test_producers() {
+    const int producers = 4;
+    const unsigned per_producer = 50000;
+    log_init();
+    uint32_t dropped = log_dropped;
+    std::atomic<int> running(producers);
+    std::vector<std::vector<unsigned>> seen(producers);
+
+    std::thread consumer([&] {
+        char line[LOG_LINE_MAX];
+        while (true) {
+            bool done = running.load() == 0;
+            while (log_pop_line(line, sizeof(line))) {
+                unsigned sec, ms, p, n;
+                if (sscanf(line, "%u.%u D p%u n%u", &sec, &ms, &p, &n) == 4 && p < (unsigned)producers) {
+                    seen[p].push_back(n);
+                } else {
+                    CHECK(false);
+                }
+            }
+            if (done) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (unsigned n = 0; n < per_producer; n++) {
+                log_write(LOG_LEVEL_DEBUG, "p%u n%u", (unsigned)p, n);
+                if ((n & 15) == 15) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));  // 소비자가 따라올 틈
+                }
+            }
+            running--;
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    consumer.join();
+
+    uint64_t received = 0;
+    for (int p = 0; p < producers; p++) {
+        for (size_t i = 1; i < seen[p].size(); i++) {
+            CHECK(seen[p][i] > seen[p][i - 1]);  // 중복 없음, 순서 유지
+        }
+        received += seen[p].size();
+    }
+    CHECK_EQ(received + (log_dropped - dropped), (uint64_t)producers * per_producer);
+    CHECK(received > 0);
+    printf("  %d producers x %u events: %llu received, %u dropped\n", producers, per_producer,
+           (unsigned long long)received, (unsigned)(log_dropped - dropped));
+}
+
+// 소비자가 따라오는 동안 LOG_I 한 번의 비용
+static void bench_write() {
+    log_init();
+    std::atomic<bool> stop(false);
+    std::thread consumer([&] {
+        char line[LOG_LINE_MAX];
+        while (!stop.load()) {
+            while (log_pop_line(line, sizeof(line))) {
+            }
+            std::this_thread::yield();
+        }
+    });
+    const int n = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        LOG_I("frame %u sent to %s", (unsigned)i, names[0]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    stop = true;
+    consumer.join();
+    printf("  LOG_I: %.0f ns per call on this host\n", ns);
+}
+
+int main() {
+    test_format();
+    test_full();
+    test_producers();
+    bench_write();
+    return check_report("log_ring");
+}
@@ -0,0 +1,124 @@
+// roi_crop.h : ROI 를 MCU 격자에 맞추고 잘라서 인코더에 B, G, R 순서로 넘기는지 시험한다.
+// 디코더 스텁은 실제 디코더처럼 16x8 블록을 위에서 아래로 RGB 순서로 넘긴다.
+
+#include <vector>
+
+#include "../../roi_crop.h"
+#include "check.h"
+
+#define IMG_W 320
+#define IMG_H 240
+
+// 화소 값이 좌표로 정해지고 세 채널이 모두 다르다
+static void pixel(int x, int y, uint8_t *rgb) {
+    rgb[0] = (uint8_t)x;
+    rgb[1] = (uint8_t)y;
+    rgb[2] = (uint8_t)(x * 3 + y * 7 + 1);
+}
+
+static int blocks_decoded;
+
+static esp_err_t fake_decode(size_t, jpg_scale_t, jpg_reader_cb, jpg_writer_cb writer, void *arg) {
+    uint8_t block[16 * 8 * 3];
+    blocks_decoded = 0;
+    writer(arg, 0, 0, IMG_W, IMG_H, NULL);
+    for (int by = 0; by < IMG_H; by += 8) {
+        for (int bx = 0; bx < IMG_W; bx += 16) {
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 16; x++) {
+                    pixel(bx + x, by + y, block + (y * 16 + x) * 3);
+                }
+            }
+            blocks_decoded++;
+            if (!writer(arg, bx, by, 16, 8, block)) {
+                return ESP_FAIL;  // 실제 디코더도 writer 가 멈추면 에러로 끝난다
+            }
+        }
+    }
+    writer(arg, 0, 0, 0, 0, NULL);
+    return ESP_OK;
+}
+
+static void test_pack_snap_scale() {
+    roi_rect_t r = { 3, 121, 300, 100 };
+    roi_rect_t u = roi_unpack(roi_pack(&r));
+    CHECK(u.x == 3 && u.y == 121 && u.w == 300 && u.h == 100);
+    roi_rect_t off = { 0, 0, 0, 0 };
+    CHECK_EQ(roi_pack(&off), 0);
+
+    roi_snap(&r);  // 바깥쪽으로 넓힌다
+    CHECK(r.x == 0 && r.y == 112 && r.w == 304 && r.h == 112);
+    CHECK(r.x <= 3 && r.x + r.w >= 303 && r.y <= 121 && r.y + r.h >= 221);
+
+    // QVGA 기준 아래 절반 -> QQVGA 에서도 아래 절반
+    roi_rect_t half = { 0, 120, 320, 120 };
+    roi_rect_t s = roi_scale(half, 320, 240, 160, 120);
+    CHECK(s.x == 0 && s.w == 160);
+    CHECK(s.y <= 60 && s.y + s.h >= 120);
+    CHECK_EQ(s.y % ROI_MCU, 0);
+    CHECK_EQ(s.h % ROI_MCU, 0);
+}
+
+static void check_crop(roi_rect_t roi, int expect_w, int expect_h) {
+    camera_fb_t fb;
+    uint8_t jpg[16] = { 0 };
+    memset(&fb, 0, sizeof(fb));
+    fb.buf = jpg;
+    fb.len = sizeof(jpg);
+    fb.width = IMG_W;
+    fb.height = IMG_H;
+
+    std::vector<uint8_t> rgb((size_t)roi.w * roi.h * 3);
+    std::vector<uint8_t> out(rgb.size());
+    size_t n = roi_crop_jpeg(&fb, roi, rgb.data(), out.data(), out.size());
+    CHECK_EQ(n, (size_t)expect_w * expect_h * 3);
+    CHECK_EQ(stub_jpg_format, PIXFORMAT_RGB888);
+    CHECK_EQ(stub_jpg_w, expect_w);
+    CHECK_EQ(stub_jpg_h, expect_h);
+
+    // 인코더가 받은 화소는 B, G, R 순서이고 ROI 안의 화소와 같다
+    int bad = 0;
+    for (int y = 0; y < expect_h; y++) {
+        for (int x = 0; x < expect_w; x++) {
+            uint8_t want[3];
+            pixel(roi.x + x, roi.y + y, want);
+            const uint8_t *got = out.data() + (y * expect_w + x) * 3;
+            bad += got[0] != want[2] || got[1] != want[1] || got[2] != want[0];
+        }
+    }
+    CHECK_EQ(bad, 0);
+}
+
+static void test_crop() {
+    tensor_prep_init();
+    stub_jpg_decode = fake_decode;
+    const int per_row = IMG_W / 16;
+
+    // 아래 절반: 위쪽 블록도 디코딩해야 하지만 ROI 를 지나면 멈춘다 (여기서는 끝까지)
+    check_crop({ 0, 112, 320, 128 }, 320, 128);
+    CHECK_EQ(blocks_decoded, per_row * (IMG_H / 8));
+
+    // 위쪽 띠: ROI 아래 첫 블록에서 디코딩을 멈춘다
+    check_crop({ 32, 16, 64, 48 }, 64, 48);
+    CHECK_EQ(blocks_decoded, per_row * (64 / 8) + 1);
+
+    // MCU 에 맞지 않는 ROI 도 화소 단위로 자른다
+    check_crop({ 5, 7, 33, 9 }, 33, 9);
+
+    // 프레임 밖으로 나가면 프레임 안으로 줄인다
+    check_crop({ 288, 224, 64, 32 }, 32, 16);
+
+    // 프레임 밖에서 시작하면 실패
+    camera_fb_t fb;
+    memset(&fb, 0, sizeof(fb));
+    fb.width = IMG_W;
+    fb.height = IMG_H;
+    uint8_t buf[16];
+    CHECK_EQ(roi_crop_jpeg(&fb, { 320, 0, 16, 16 }, buf, buf, sizeof(buf)), 0);
+}
+
+int main() {
+    test_pack_snap_scale();
+    test_crop();
+    return check_report("roi_crop");
+}
@@ -0,0 +1,195 @@
+// stream_sender.h : 전송 태스크 풀로 여러 시청자에게 동시에 보내는지 socketpair 로 시험한다.
+// 태스크가 모두 바쁘면 새 세션과 다운로드를 거절하고, 시청자가 끊기면 태스크가 풀로 돌아온다.
+
+#include <signal.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../stream_sender.h"
+#include "check.h"
+
+int car_angle = 0;
+int car_speed = 0;
+static std::atomic<int> capture_clients(0);
+void capture_client_join() { capture_clients++; }
+void capture_client_leave() { capture_clients--; }
+
+#define FB_COUNT 3
+#define FRAME_LEN 4000
+
+static camera_fb_t fbs[FB_COUNT];
+static uint8_t fb_data[FB_COUNT][FRAME_LEN];
+static std::atomic<int> fb_out[FB_COUNT];
+static std::mutex pool_lock;
+static std::condition_variable pool_cv;
+
+static camera_fb_t *pool_get(uint32_t seq) {
+    std::unique_lock<std::mutex> lk(pool_lock);
+    while (true) {
+        for (int i = 0; i < FB_COUNT; i++) {
+            if (fb_out[i] == 0) {
+                fb_out[i] = 1;
+                fbs[i].buf = fb_data[i];
+                fbs[i].len = FRAME_LEN - seq % 100;
+                fbs[i].width = 320;
+                fbs[i].height = 240;
+                fbs[i].timestamp.tv_sec = seq;
+                return &fbs[i];
+            }
+        }
+        pool_cv.wait(lk);
+    }
+}
+
+// 시청자 하나: 소켓에서 읽은 multipart 스트림의 X-Frame-Seq 를 센다
+struct viewer_t {
+    int sv[2];
+    std::thread reader;
+    std::atomic<bool> stop;
+    std::vector<uint32_t> seqs;
+    std::string head;
+};
+
+static void viewer_read(viewer_t *v, int delay_us) {
+    std::string data;
+    char buf[4096];
+    size_t scan = 0;
+    while (!v->stop) {
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(v->sv[1], &rd);
+        struct timeval tv = { 0, 20000 };
+        if (select(v->sv[1] + 1, &rd, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+        ssize_t n = read(v->sv[1], buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        data.append(buf, n);
+        size_t pos;
+        while ((pos = data.find("X-Frame-Seq: ", scan)) != std::string::npos && data.find("\r\n", pos) != std::string::npos) {
+            v->seqs.push_back((uint32_t)strtoul(data.c_str() + pos + 13, NULL, 10));
+            scan = pos + 13;
+        }
+        if (v->head.empty() && data.size() > 16) {
+            v->head = data.substr(0, 16);
+        }
+        if (delay_us) {
+            std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+        }
+    }
+}
+
+static esp_err_t hello_job(stream_ctx_t *ctx, void *arg) {
+    const char *body = (const char *)arg;
+    char hdr[128];
+    int n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                     (unsigned)strlen(body));
+    if (stream_job_write(ctx, hdr, n) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return stream_job_write(ctx, body, strlen(body));
+}
+
+static bool wait_idle(int want, int ms) {
+    for (int i = 0; i < ms / 10; i++) {
+        if (__atomic_load_n(&stream_idle_senders, __ATOMIC_ACQUIRE) == want) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+static void test_pool() {
+    httpd_handle_t server = (httpd_handle_t)0x81;
+    viewer_t viewers[STREAM_SENDER_TASKS];
+    for (int i = 0; i < STREAM_SENDER_TASKS; i++) {
+        viewer_t *v = &viewers[i];
+        CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, v->sv), 0);
+        v->stop = false;
+        httpd_req_t req = {};
+        req.handle = server;
+        req.fd = v->sv[0];
+        CHECK_EQ(stream_session_start(&req, "viewer"), ESP_OK);
+        v->reader = std::thread(viewer_read, v, i == 2 ? 20000 : 0);  // 세 번째 시청자는 느리다
+    }
+    CHECK_EQ(capture_clients, STREAM_SENDER_TASKS);
+
+    // 태스크가 모두 바쁘다
+    int extra[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, extra), 0);
+    httpd_req_t req = {};
+    req.handle = server;
+    req.fd = extra[0];
+    CHECK_EQ(stream_session_start(&req, "viewer"), ESP_FAIL);
+    CHECK(!stream_job_start(&req, "download", hello_job, (void *)"hello"));
+
+    // 캡처: 200 프레임을 5 ms 간격으로 게시
+    for (uint32_t seq = 1; seq <= 200; seq++) {
+        frame_publish(pool_get(seq));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    // 시청자가 끊으면 전송 태스크가 세션을 끝내고 풀로 돌아온다
+    for (int i = 0; i < STREAM_SENDER_TASKS; i++) {
+        viewers[i].stop = true;
+        viewers[i].reader.join();
+        close(viewers[i].sv[1]);
+    }
+    std::thread capture([] {
+        for (uint32_t seq = 201; seq <= 260; seq++) {
+            frame_publish(pool_get(seq));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    CHECK(wait_idle(STREAM_SENDER_TASKS, 3000));
+    capture.join();
+    CHECK_EQ(capture_clients, 0);
+    {
+        std::lock_guard<std::mutex> lk(stub_closed_lock);
+        CHECK_EQ(stub_closed_fds.size(), STREAM_SENDER_TASKS);
+    }
+
+    for (int i = 0; i < STREAM_SENDER_TASKS; i++) {
+        viewer_t *v = &viewers[i];
+        CHECK(v->head.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+        CHECK(v->seqs.size() > 10);
+        bool increasing = true;
+        for (size_t k = 1; k < v->seqs.size(); k++) {
+            increasing = increasing && v->seqs[k] > v->seqs[k - 1];
+        }
+        CHECK(increasing);
+        printf("  viewer %d%s: %u of 200 frames\n", i, i == 2 ? " (slow)" : "", (unsigned)v->seqs.size());
+        close(v->sv[0]);
+    }
+
+    // 이제 다운로드를 받는다
+    CHECK(stream_job_start(&req, "download", hello_job, (void *)"hello"));
+    CHECK(wait_idle(STREAM_SENDER_TASKS, 1000));
+    char buf[256];
+    ssize_t n = read(extra[1], buf, sizeof(buf) - 1);
+    buf[n > 0 ? n : 0] = '\0';
+    CHECK(strstr(buf, "Connection: close\r\n\r\nhello") != NULL);
+    close(extra[0]);
+    close(extra[1]);
+}
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);  // 끊긴 시청자에게 쓰면 EPIPE 로 받는다
+    log_init();
+    block_pool_init();
+    camera_fb_count = FB_COUNT;
+    frame_share_init();
+    stub_fb_return = [](camera_fb_t *fb) {
+        std::lock_guard<std::mutex> lk(pool_lock);
+        fb_out[fb - fbs] = 0;
+        pool_cv.notify_all();
+    };
+    stream_sender_init();
+    test_pool();
+    return check_report("sender_pool");
+}
@@ -0,0 +1,57 @@
+// /stats 의 JSON 함수들이 버퍼가 작아도 len 보다 작은 길이를 돌려주고, 잘린 내용이
+// 전체 출력의 앞부분과 같은지 시험한다 (stats_handler 는 그 길이를 그대로 청크로 보낸다).
+
+#include <functional>
+#include <string>
+
+#include "../../telemetry.h"
+#include "../../ctrl_dispatch.h"
+#include "../../blackbox.h"
+#include "../../ws_rx.h"
+#include "check.h"
+
+int car_angle = 0;
+int car_speed = 0;
+
+typedef std::function<int(char *, size_t)> json_fn_t;
+
+static void check_fits(const char *name, json_fn_t fn) {
+    char full[1024];
+    int n = fn(full, sizeof(full));
+    CHECK(n > 0 && n < (int)sizeof(full));
+    CHECK_EQ(strlen(full), n);
+    bool ok = true;
+    for (size_t len = 1; len <= (size_t)n + 1; len++) {
+        char buf[1024];
+        memset(buf, '#', sizeof(buf));
+        int m = fn(buf, len);
+        ok = ok && m >= 0 && m < (int)len && buf[m] == '\0' && memcmp(buf, full, m) == 0 && buf[len] == '#';
+    }
+    if (!ok) {
+        printf("  %s does not fit small buffers\n", name);
+    }
+    CHECK(ok);
+}
+
+int main() {
+    stub_now_us = 5000000;  // rate 가 호출마다 달라지지 않게 시계를 세운다
+    log_init();
+    block_pool_init();
+    stats_hist_reset(&ctrl_stats.json_us);
+    stats_hist_reset(&ctrl_stats.binary_us);
+    stats_hist_add(&ctrl_stats.json_us, 123, 0);
+    stats_hist_add(&capture_stats.wait_us, 4567, 20000);
+    cmd_table_init();
+    cmd_register(CMD_HASH("move"), "move", CMD_EP_MASK(CMD_EP_PC), NULL);
+
+    check_fits("stats_summary_json", [](char *b, size_t l) { return stats_summary_json(b, l, &capture_stats.wait_us); });
+    check_fits("ctrl_stats_json", ctrl_stats_json);
+    check_fits("motor_stats_json", motor_stats_json);
+    check_fits("blackbox_json", blackbox_json);
+    check_fits("ws_rx_json", ws_rx_json);
+    check_fits("telemetry_stats_json", telemetry_stats_json);
+    check_fits("block_pool_json", block_pool_json);
+    check_fits("log_stats_json", log_stats_json);
+    check_fits("cmd_entry_json", [](char *b, size_t l) { return cmd_entry_json(0, b, l); });
+    return check_report("stats_json");
+}
@@ -0,0 +1,132 @@
+// still_frame.h : 크기와 샘플 바이트를 모두 봐야 정지 화면으로 판단하는지 프레임 기록으로 시험한다.
+//
+// 기록은 OV2640 QVGA JPEG 의 모양을 흉내 낸 것이다.
+//   - 앞 600 바이트는 양자화/허프만 표 (품질과 해상도가 같으면 같다)
+//   - 서 있을 때: 장면이 같고 센서 노이즈로 뒤쪽 일부 MCU 만 바뀐다. 크기는 +-0.3% 흔들린다.
+//   - 움직일 때: 장면이 매 프레임 바뀌지만 크기는 거의 같다 (+-0.5%). 크기만 보면 정지 화면으로 오인한다.
+
+#include <random>
+#include <vector>
+
+#include "../../still_frame.h"
+#include "check.h"
+
+#define HEADER_LEN 600
+
+static std::mt19937 rng(17);
+
+// scene 으로 정해지는 본문. noise_from 부터 끝까지는 noise 로 정해지는 바이트로 바꾼다.
+static std::vector<uint8_t> make_frame(uint32_t scene, size_t len, float noise_from, uint32_t noise) {
+    std::vector<uint8_t> buf(len);
+    for (size_t i = 0; i < HEADER_LEN; i++) {
+        buf[i] = (uint8_t)(i * 29);
+    }
+    std::mt19937 body(scene);
+    std::mt19937 tail(noise);
+    size_t from = (size_t)(noise_from * len);
+    for (size_t i = HEADER_LEN; i < len; i++) {
+        buf[i] = (uint8_t)(i < from ? body() : tail());
+    }
+    return buf;
+}
+
+static size_t jitter(size_t len, float frac) {
+    std::uniform_real_distribution<float> d(-frac, frac);
+    return (size_t)(len * (1 + d(rng)));
+}
+
+struct segment_t {
+    const char *name;
+    int frames;
+    bool moving;
+    float noise_from;   // 서 있을 때 노이즈가 시작되는 위치 (프레임 길이 대비)
+};
+
+static bool detect(const std::vector<uint8_t> &buf) {
+    camera_fb_t fb;
+    memset(&fb, 0, sizeof(fb));
+    fb.buf = (uint8_t *)buf.data();
+    fb.len = buf.size();
+    return still_detect(&fb);
+}
+
+// 구간마다 정지 화면으로 판단한 프레임 수를 센다
+static void run(const segment_t *seg, int count, int *still) {
+    uint32_t scene = 1;
+    size_t len = 12000;
+    for (int s = 0; s < count; s++) {
+        still[s] = 0;
+        scene++;
+        for (int f = 0; f < seg[s].frames; f++) {
+            std::vector<uint8_t> buf;
+            if (seg[s].moving) {
+                scene++;
+                len = jitter(len, 0.005f);
+                buf = make_frame(scene, len, 1.0f, 0);
+            } else {
+                buf = make_frame(scene, jitter(len, 0.003f), seg[s].noise_from, rng());
+            }
+            still[s] += detect(buf);
+        }
+    }
+}
+
+static void test_recorded_sequence() {
+    const segment_t seq[] = {
+        { "parked", 30, false, 0.95f },
+        { "driving", 40, true, 0 },
+        { "parked, noisy tail", 30, false, 0.90f },
+        { "driving", 40, true, 0 },
+        { "parked, noise from the middle", 30, false, 0.50f },
+        { "parked", 30, false, 0.95f },
+    };
+    const int count = sizeof(seq) / sizeof(seq[0]);
+    int still[count];
+    still_reset();
+    run(seq, count, still);
+    for (int s = 0; s < count; s++) {
+        printf("  %-32s %2d frames -> %2d still\n", seq[s].name, seq[s].frames, still[s]);
+    }
+    // 서 있으면 STILL_MIN_FRAMES 뒤부터 모두 정지 화면
+    CHECK_EQ(still[0], seq[0].frames - STILL_MIN_FRAMES);
+    CHECK_EQ(still[2], seq[2].frames - STILL_MIN_FRAMES);
+    CHECK_EQ(still[5], seq[5].frames - STILL_MIN_FRAMES);
+    // 움직이는 동안에는 크기가 비슷해도 하나도 숨기지 않는다
+    CHECK_EQ(still[1], 0);
+    CHECK_EQ(still[3], 0);
+    // 화면 절반이 흔들리면 바뀐 것으로 본다 (보내는 쪽으로 틀린다)
+    CHECK_EQ(still[4], 0);
+}
+
+// 크기가 1% 넘게 바뀌면 샘플이 같아도 바뀐 프레임
+static void test_size_prefilter() {
+    still_reset();
+    std::vector<uint8_t> a = make_frame(5, 10000, 1.0f, 0);
+    for (int i = 0; i < STILL_MIN_FRAMES + 2; i++) {
+        detect(a);
+    }
+    CHECK(detect(a));
+    std::vector<uint8_t> b = make_frame(5, 10200, 1.0f, 0);  // 같은 장면, 2% 길다
+    CHECK(!detect(b));
+    CHECK_EQ(still_state.similar, 0);
+    CHECK_EQ(still_state.ref_len, 10200);
+}
+
+// 차가 움직이기 시작하면 바로 풀린다
+static void test_release() {
+    still_reset();
+    std::vector<uint8_t> a = make_frame(9, 11000, 0.97f, 1);
+    for (int i = 0; i < STILL_MIN_FRAMES + 3; i++) {
+        detect(make_frame(9, 11000, 0.97f, i));
+    }
+    CHECK(detect(a));
+    CHECK(!detect(make_frame(10, 11010, 1.0f, 0)));
+    CHECK(!detect(make_frame(9, 11000, 0.97f, 2)));  // 새 기준에서 다시 센다
+}
+
+int main() {
+    test_recorded_sequence();
+    test_size_prefilter();
+    test_release();
+    return check_report("still");
+}
@@ -0,0 +1,326 @@
+// stream_sender.h : 부분 전송, 막힌 소켓, 강등/복귀를 가짜 send_fn 과 socketpair 로 시험한다.
+
+#include <limits.h>
+#include <random>
+#include <string>
+
+#include "../../stream_sender.h"
+#include "check.h"
+
+int car_angle = 0;
+int car_speed = 0;
+void capture_client_join() {}
+void capture_client_leave() {}
+
+// 호출마다 최대 limit 바이트만 받는 소켓 흉내. fail_after 번째 호출부터는 -1 (끊김).
+static std::string fake_wire;
+static size_t fake_limit;
+static int fake_calls;
+static int fake_fail_after;
+static std::mt19937 fake_rng(7);
+
+static int fake_send(stream_ctx_t *ctx, const struct iovec *iov, int iovcnt) {
+    if (fake_fail_after >= 0 && fake_calls >= fake_fail_after) {
+        return -1;
+    }
+    fake_calls++;
+    size_t room = 1 + fake_rng() % fake_limit;
+    size_t n = 0;
+    for (int i = 0; i < iovcnt && room > 0; i++) {
+        size_t take = min(room, iov[i].iov_len);
+        fake_wire.append((const char *)iov[i].iov_base, take);
+        n += take;
+        room -= take;
+    }
+    return (int)n;
+}
+
+static void fake_init(stream_ctx_t *ctx, size_t limit, int fail_after = -1) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->name = "test";
+    ctx->send_fn = fake_send;
+    fake_wire.clear();
+    fake_limit = limit;
+    fake_calls = 0;
+    fake_fail_after = fail_after;
+}
+
+// 어디서 잘려도 순서대로 한 번씩만 보낸다
+static void test_partial_writes() {
+    std::string hdr = "Content-Type: image/jpeg\r\n\r\n";
+    std::string jpg(30000, 0);
+    for (size_t i = 0; i < jpg.size(); i++) {
+        jpg[i] = (char)(i * 13);
+    }
+    std::string tail = "\r\n--boundary\r\n";
+    const size_t limits[] = { 1, 7, 100, 1460, 65536 };
+    for (size_t limit : limits) {
+        stream_ctx_t ctx;
+        fake_init(&ctx, limit);
+        struct iovec iov[4] = {
+            { (void *)hdr.data(), hdr.size() },
+            { (void *)"", 0 },  // 빈 조각도 건너뛴다
+            { (void *)jpg.data(), jpg.size() },
+            { (void *)tail.data(), tail.size() },
+        };
+        CHECK_EQ(stream_send_iov(&ctx, iov, 4), ESP_OK);
+        CHECK(fake_wire == hdr + jpg + tail);
+        CHECK_EQ(ctx.wire_bytes, hdr.size() + jpg.size() + tail.size());
+        CHECK_EQ(ctx.send_calls, fake_calls);
+        if (limit == 1) {
+            CHECK_EQ(fake_calls, (int)fake_wire.size());
+        }
+    }
+}
+
+// 중간에 끊기면 더 보내지 않고 실패한다
+static void test_send_failure() {
+    stream_ctx_t ctx;
+    fake_init(&ctx, 100, 5);
+    std::string data(10000, 'x');
+    CHECK_EQ(stream_send_all(&ctx, data.data(), data.size()), ESP_FAIL);
+    CHECK_EQ(fake_calls, 5);
+    CHECK_EQ(ctx.send_calls, 6);
+    CHECK(ctx.wire_bytes <= 500);
+}
+
+// 실제 소켓: 받는 쪽이 천천히 읽으면 부분 전송을 이어서 끝낸다
+static void test_socket_throttled() {
+    int sv[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    int small = 4096;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+    stream_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.name = "socket";
+    ctx.fd = sv[0];
+    ctx.send_fn = stream_sock_send;
+
+    std::string data(200000, 0);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (char)(i * 7 + 3);
+    }
+    std::string got;
+    std::thread reader([&] {
+        char buf[2048];
+        while (got.size() < data.size()) {
+            ssize_t n = read(sv[1], buf, sizeof(buf));
+            if (n <= 0) {
+                break;
+            }
+            got.append(buf, n);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+    CHECK_EQ(stream_send_all(&ctx, data.data(), data.size()), ESP_OK);
+    reader.join();
+    CHECK(got == data);
+    CHECK(ctx.send_calls > 1);
+    CHECK(!ctx.evicted);
+    printf("  200000 bytes through a throttled socket in %u send calls\n", (unsigned)ctx.send_calls);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// 실제 소켓: 받는 쪽이 멈추면 STREAM_EVICT_US 뒤에 끊고, 서버가 닫으면 바로 그만둔다
+static void test_socket_stalled() {
+    int sv[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    stream_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.name = "stalled";
+    ctx.fd = sv[0];
+    ctx.send_fn = stream_sock_send;
+    std::string data(4 << 20, 'z');  // 소켓 버퍼보다 훨씬 크다
+
+    // 시계를 멈춰 두고 다른 스레드가 제한 시간을 넘긴다
+    stub_now_us = 0;
+    std::thread clock([] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        stub_now_us = STREAM_EVICT_US + 1;
+    });
+    CHECK_EQ(stream_send_all(&ctx, data.data(), data.size()), ESP_FAIL);
+    clock.join();
+    stub_now_us = -1;
+    CHECK(ctx.evicted);
+    CHECK(ctx.wire_bytes > 0 && ctx.wire_bytes < data.size());
+
+    // close_fn 이 closed 를 세우면 100 ms 안에 빠져나온다 (evicted 는 아님)
+    ctx.evicted = false;
+    std::thread closer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ctx.closed = true;
+    });
+    int64_t start = esp_timer_get_time();
+    CHECK_EQ(stream_send_all(&ctx, data.data(), data.size()), ESP_FAIL);
+    closer.join();
+    CHECK(esp_timer_get_time() - start < 500000);
+    CHECK(!ctx.evicted);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// 실제 소켓: select 가 실패하면 (닫힌 fd) 제한 시간까지 돌지 않고 바로 실패한다
+static void test_socket_error() {
+    int sv[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    close(sv[0]);
+    close(sv[1]);
+    CHECK_EQ(stream_sock_writable(sv[0], 0), -1);
+
+    stream_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.name = "broken";
+    ctx.fd = sv[0];
+    ctx.send_fn = stream_sock_send;
+    std::string data(1000, 'e');
+    int64_t start = esp_timer_get_time();
+    CHECK_EQ(stream_send_all(&ctx, data.data(), data.size()), ESP_FAIL);
+    CHECK(esp_timer_get_time() - start < 100000);
+    CHECK(!ctx.evicted);
+    CHECK_EQ(ctx.wire_bytes, 0);
+    CHECK(stream_admit_frame(&ctx));  // 건너뛰지 않고 보내 봐서 오류로 끝낸다
+    CHECK_EQ(ctx.backpressure, 0);
+}
+
+// 늦은 프레임마다 한 단계 강등 (2^n 프레임에 하나), 제때 이어지면 복귀, 끝까지 늦으면 끊는다
+static void test_demote_promote() {
+    int sv[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    stream_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.name = "demote";
+    ctx.fd = sv[0];
+    ctx.kind = STREAM_MULTIPART;
+
+    CHECK(stream_check_deadline(&ctx, STREAM_SEND_DEADLINE_US + 1));
+    CHECK_EQ(ctx.demote, 1);
+    int admitted = 0;
+    for (int i = 0; i < 8; i++) {
+        admitted += stream_admit_frame(&ctx);
+    }
+    CHECK_EQ(admitted, 4);
+    CHECK(stream_check_deadline(&ctx, STREAM_SEND_DEADLINE_US + 1));
+    CHECK_EQ(ctx.demote, 2);
+    admitted = 0;
+    for (int i = 0; i < 8; i++) {
+        admitted += stream_admit_frame(&ctx);
+    }
+    CHECK_EQ(admitted, 2);
+
+    for (int i = 0; i < STREAM_PROMOTE_FRAMES; i++) {
+        CHECK(stream_check_deadline(&ctx, 1000));
+    }
+    CHECK_EQ(ctx.demote, 1);
+
+    while (ctx.demote < STREAM_DEMOTE_MAX) {
+        CHECK(stream_check_deadline(&ctx, STREAM_SEND_DEADLINE_US + 1));
+    }
+    CHECK(!stream_check_deadline(&ctx, STREAM_SEND_DEADLINE_US + 1));
+    CHECK(ctx.evicted);
+    CHECK_EQ(ctx.stalls, 2 + STREAM_DEMOTE_MAX);  // 1 -> 2, 복귀 뒤 1 -> 3, 끊김
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// /video_ws 의 PING 은 전송 태스크가 다음 프레임 앞에서 PONG 으로 답한다 (크레딧이 없어도)
+static void test_ws_pong() {
+    frame_share_init();
+    int sub = frame_subscribe();
+    CHECK(sub >= 0);
+    stream_ctx_t *ctx = &stream_clients[sub];
+    fake_init(ctx, 65536);
+    httpd_handle_t server = (httpd_handle_t)0x81;
+    ctx->name = "video_ws";
+    ctx->sub = sub;
+    ctx->kind = STREAM_WEBSOCKET;
+    ctx->server = server;
+    ctx->fd = 9;
+    ctx->credits = 0;
+
+    const uint8_t ping[] = { 'a', 'b', 'c' };
+    CHECK(!stream_ws_ping(server, 10, ping, 3));  // 다른 연결
+    CHECK(stream_ws_ping(server, 9, ping, 3));
+    CHECK(stream_ws_ping(server, 9, (const uint8_t *)"x", 1));  // 앞 PING 에 답하기 전이면 버린다
+    CHECK_EQ(send_frame(ctx), ESP_OK);
+    CHECK(fake_wire == std::string("\x8A\x03" "abc", 5));
+    CHECK(!ctx->pong_pending);
+
+    fake_wire.clear();
+    CHECK(stream_ws_ping(server, 9, NULL, 0));
+    CHECK_EQ(send_frame(ctx), ESP_OK);
+    CHECK(fake_wire == std::string("\x8A\x00", 2));
+    std::string big(STREAM_WS_CONTROL_MAX + 1, 'p');
+    CHECK(!stream_ws_ping(server, 9, (const uint8_t *)big.data(), big.size()));
+
+    ctx->name = NULL;
+    frame_unsubscribe(sub);
+}
+
+// 크레딧은 범위 밖의 값을 무시하고, 합이 STREAM_WS_MAX_CREDITS 를 넘지 않는다
+static void test_ws_credit() {
+    memset(stream_clients, 0, sizeof(stream_clients));
+    frame_share_init();
+    int sub = frame_subscribe();
+    stream_ctx_t *ctx = &stream_clients[sub];
+    httpd_handle_t server = (httpd_handle_t)0x81;
+    ctx->name = "video_ws";
+    ctx->sub = sub;
+    ctx->kind = STREAM_WEBSOCKET;
+    ctx->server = server;
+    ctx->fd = 9;
+    ctx->credits = STREAM_WS_INITIAL_CREDITS;
+
+    CHECK(!stream_ws_credit(server, 9, 0));
+    CHECK(!stream_ws_credit(server, 9, -5));
+    CHECK(!stream_ws_credit(server, 9, STREAM_WS_MAX_CREDITS + 1));
+    CHECK(!stream_ws_credit(server, 9, INT_MAX));
+    CHECK(!stream_ws_credit(server, 10, 1));  // 다른 연결
+    CHECK_EQ(ctx->credits, STREAM_WS_INITIAL_CREDITS);
+
+    CHECK(stream_ws_credit(server, 9, 1));
+    CHECK_EQ(ctx->credits, STREAM_WS_INITIAL_CREDITS + 1);
+    for (int i = 0; i < 100; i++) {
+        CHECK(stream_ws_credit(server, 9, STREAM_WS_MAX_CREDITS));
+    }
+    CHECK_EQ(ctx->credits, STREAM_WS_MAX_CREDITS);
+
+    ctx->name = NULL;
+    frame_unsubscribe(sub);
+}
+
+// udp_stream off 는 그 PC 로 가는 UDP 세션만 끝낸다
+static void test_udp_stop() {
+    memset(stream_clients, 0, sizeof(stream_clients));
+    const uint32_t ips[3] = { 0x0A01A8C0, 0x0B01A8C0, 0x0A01A8C0 };  // 192.168.1.10, .11, .10 (다른 포트)
+    for (int i = 0; i < 3; i++) {
+        stream_clients[i].name = "udp_stream";
+        stream_clients[i].kind = STREAM_UDP;
+        stream_clients[i].udp_dest.sin_addr.s_addr = ips[i];
+    }
+    stream_clients[3].name = "stream";  // 같은 PC 의 MJPEG 스트림은 건드리지 않는다
+    stream_clients[3].kind = STREAM_MULTIPART;
+    stream_clients[3].peer_ip = ips[0];
+
+    CHECK(stream_udp_stop(ips[0]));
+    CHECK(stream_clients[0].closed && stream_clients[2].closed);
+    CHECK(!stream_clients[1].closed && !stream_clients[3].closed);
+    CHECK(!stream_udp_stop(0x0C01A8C0));
+    memset(stream_clients, 0, sizeof(stream_clients));
+}
+
+int main() {
+    log_init();
+    test_partial_writes();
+    test_send_failure();
+    test_socket_throttled();
+    test_socket_stalled();
+    test_socket_error();
+    test_demote_promote();
+    test_ws_pong();
+    test_ws_credit();
+    test_udp_stop();
+    return check_report("stream_send");
+}
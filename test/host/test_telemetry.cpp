@@ -0,0 +1,72 @@
+// telemetry.h : 큐에 넣은 보내기 작업이 실행될 때 구독이 바뀌었거나 fd 가 다른 연결로
+// 넘어갔으면 보내지 않는지 시험한다.
+
+#include "../../telemetry.h"
+#include "check.h"
+
+int car_angle = 0;
+int car_speed = 0;
+
+static httpd_handle_t server = (httpd_handle_t)0x81;
+
+// 텔레메트리 태스크가 큐에 넣기 직전까지 하는 일
+static telemetry_sub_t *queue_message(int fd) {
+    for (int i = 0; i < TELEMETRY_MAX_SUBS; i++) {
+        telemetry_sub_t *t = &telemetry_subs[i];
+        if (t->server == server && t->fd == fd) {
+            t->send_server = t->server;
+            t->send_fd = t->fd;
+            t->send_gen = t->gen;
+            t->send_binary = false;
+            t->len = snprintf((char *)t->buf, sizeof(t->buf), "{\"seq\":%u}", (unsigned)t->seq++);
+            t->pending = true;
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static void test_send() {
+    memset(telemetry_subs, 0, sizeof(telemetry_subs));
+    memset(&telemetry_stats, 0, sizeof(telemetry_stats));
+    stub_ws_log.clear();
+    stub_fd_info = HTTPD_WS_CLIENT_WEBSOCKET;
+
+    CHECK(telemetry_subscribe(server, 5, 10, false));
+    telemetry_sub_t *t = queue_message(5);
+    CHECK(t != NULL);
+    telemetry_send_work(t);
+    CHECK_EQ(stub_ws_log.size(), 1);
+    CHECK_EQ(stub_ws_log[0].fd, 5);
+    CHECK_EQ(telemetry_stats.sent, 1);
+    CHECK(!t->pending);
+
+    // 큐에 있는 동안 구독을 풀고 같은 자리에 다른 연결이 구독했다
+    t = queue_message(5);
+    telemetry_unsubscribe(server, 5);
+    CHECK(telemetry_subscribe(server, 6, 10, false));
+    telemetry_send_work(t);
+    CHECK_EQ(stub_ws_log.size(), 1);
+    CHECK_EQ(telemetry_stats.stale, 1);
+    CHECK(!t->pending);
+    CHECK(telemetry_subs[0].server == server && telemetry_subs[0].fd == 6);  // 새 구독은 그대로
+
+    // fd 6 이 닫히고 그 번호가 일반 HTTP 연결에 다시 쓰였다 (close_fn 보다 먼저)
+    t = queue_message(6);
+    stub_fd_info = HTTPD_WS_CLIENT_HTTP;
+    telemetry_send_work(t);
+    CHECK_EQ(stub_ws_log.size(), 1);
+    CHECK_EQ(telemetry_stats.stale, 2);
+    CHECK(telemetry_subs[0].server == NULL);  // 구독도 푼다
+    CHECK_EQ(telemetry_stats.errors, 0);
+
+    char json[128];
+    CHECK(telemetry_stats_json(json, sizeof(json)) < (int)sizeof(json));
+    CHECK(strstr(json, "\"stale\":2") != NULL);
+}
+
+int main() {
+    log_init();
+    test_send();
+    return check_report("telemetry");
+}
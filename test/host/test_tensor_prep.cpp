@@ -0,0 +1,141 @@
+// tensor_prep.h : 축소 비율 선택, 최근접 보간, 회색/RGB 변환을 시험하고 블록 콜백 비용을 잰다.
+// 디코더 스텁은 축소된 크기의 이미지를 16x8 블록으로 위에서 아래로 넘긴다.
+
+#include <chrono>
+#include <vector>
+
+#include "../../stream_sender.h"
+#include "check.h"
+
+int car_angle = 0;
+int car_speed = 0;
+void capture_client_join() {}
+void capture_client_leave() {}
+
+static void pixel(int x, int y, uint8_t *rgb) {
+    rgb[0] = (uint8_t)(x * 5);
+    rgb[1] = (uint8_t)(y * 3);
+    rgb[2] = (uint8_t)(x + y * 7);
+}
+
+static jpg_scale_t last_scale;
+
+static esp_err_t fake_decode(size_t, jpg_scale_t scale, jpg_reader_cb, jpg_writer_cb writer, void *arg) {
+    camera_fb_t *fb = (camera_fb_t *)((tensor_job_t *)arg)->jpg;  // 테스트는 buf 에 fb 자신을 넣는다
+    last_scale = scale;
+    int w = fb->width >> scale;
+    int h = fb->height >> scale;
+    uint8_t block[16 * 8 * 3];
+    writer(arg, 0, 0, w, h, NULL);
+    for (int by = 0; by < h; by += 8) {
+        for (int bx = 0; bx < w; bx += 16) {
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 16; x++) {
+                    pixel(bx + x, by + y, block + (y * 16 + x) * 3);
+                }
+            }
+            if (!writer(arg, bx, by, 16, 8, block)) {
+                return ESP_FAIL;
+            }
+        }
+    }
+    writer(arg, 0, 0, 0, 0, NULL);
+    return ESP_OK;
+}
+
+static camera_fb_t make_fb(int w, int h) {
+    camera_fb_t fb;
+    memset(&fb, 0, sizeof(fb));
+    fb.width = w;
+    fb.height = h;
+    return fb;
+}
+
+static bool convert(camera_fb_t *fb, dl_matrix3du_t *t) {
+    fb->buf = (uint8_t *)fb;
+    fb->len = sizeof(*fb);
+    return tensor_from_jpeg(fb, t);
+}
+
+// 출력 화소마다 축소 이미지의 최근접 화소와 같은지
+static int bad_pixels(const camera_fb_t *fb, const dl_matrix3du_t *t) {
+    int sw = fb->width >> last_scale;
+    int sh = fb->height >> last_scale;
+    int bad = 0;
+    for (int oy = 0; oy < t->h; oy++) {
+        for (int ox = 0; ox < t->w; ox++) {
+            uint8_t rgb[3];
+            pixel((ox * sw + sw / 2) / t->w, (oy * sh + sh / 2) / t->h, rgb);
+            const uint8_t *p = t->item + (oy * t->w + ox) * t->c;
+            if (t->c == 3) {
+                bad += p[0] != rgb[0] || p[1] != rgb[1] || p[2] != rgb[2];
+            } else {
+                bad += p[0] != ((rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8);
+            }
+        }
+    }
+    return bad;
+}
+
+static void test_convert() {
+    struct {
+        int w, h, size;
+        jpg_scale_t scale;
+    } cases[] = {
+        { 320, 240, 96, JPG_SCALE_2X },
+        { 160, 120, 96, JPG_SCALE_NONE },
+        { 800, 600, 96, JPG_SCALE_4X },
+        { 1600, 1200, 96, JPG_SCALE_8X },
+        { 640, 480, 160, JPG_SCALE_2X },
+    };
+    for (auto &c : cases) {
+        for (int ch = 1; ch <= 3; ch += 2) {
+            camera_fb_t fb = make_fb(c.w, c.h);
+            dl_matrix3du_t *t = stream_tensor_alloc(c.size, c.size, ch);
+            CHECK(t != NULL);
+            memset(t->item, 0xEE, c.size * c.size * ch);
+            CHECK(convert(&fb, t));
+            CHECK_EQ(last_scale, c.scale);
+            CHECK_EQ(bad_pixels(&fb, t), 0);
+            block_free(t);
+        }
+    }
+    camera_fb_t fb = make_fb(320, 240);
+    dl_matrix3du_t *t = stream_tensor_alloc(96, 96, 2);
+    CHECK(!convert(&fb, t));
+    block_free(t);
+}
+
+// 디코딩을 뺀 콜백 비용 (QVGA -> 1/2 축소 160x120 -> 96x96)
+static void bench() {
+    const int frames = 2000;
+    for (int ch = 1; ch <= 3; ch += 2) {
+        dl_matrix3du_t *t = stream_tensor_alloc(96, 96, ch);
+        std::vector<uint8_t> block(16 * 8 * 3, 0x55);
+        tensor_job_t job;
+        memset(&job, 0, sizeof(job));
+        job.out = t;
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            tensor_jpg_write(&job, 0, 0, 160, 120, NULL);
+            for (int by = 0; by < 120; by += 8) {
+                for (int bx = 0; bx < 160; bx += 16) {
+                    tensor_jpg_write(&job, bx, by, 16, 8, block.data());
+                }
+            }
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+        printf("  160x120 -> 96x96x%d: %.1f us per frame on this host (decode excluded)\n", ch, us);
+        block_free(t);
+    }
+}
+
+int main() {
+    log_init();
+    block_pool_init();
+    tensor_prep_init();
+    stub_jpg_decode = fake_decode;
+    test_convert();
+    bench();
+    return check_report("tensor_prep");
+}
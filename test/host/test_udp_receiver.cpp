@@ -0,0 +1,216 @@
+// pc/udp_jpeg_receiver.h 를 루프백 UDP 로 시험한다.
+// 조각 순서 뒤섞기, 조각 빠짐, 늦게 온 조각, 차 재부팅 (프레임 번호가 1 부터 다시 시작).
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../../pc/udp_jpeg_receiver.h"
+#include "check.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+static int tx_fd = -1;
+static sockaddr_in rx_addr;
+
+// 프레임 내용은 번호로 정해진다 (받은 쪽에서 맞는지 확인한다)
+static bytes_t frame_data(uint32_t id, size_t len) {
+    bytes_t d(len);
+    for (size_t i = 0; i < len; i++) {
+        d[i] = (uint8_t)(id * 31 + i * 7);
+    }
+    return d;
+}
+
+static std::vector<bytes_t> fragments(uint32_t id, size_t len) {
+    bytes_t data = frame_data(id, len);
+    uint16_t count = (uint16_t)((len + UDP_FRAG_PAYLOAD - 1) / UDP_FRAG_PAYLOAD);
+    std::vector<bytes_t> out;
+    for (uint16_t i = 0; i < count; i++) {
+        udp_frag_hdr_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic = UDP_FRAG_MAGIC;
+        hdr.version = UDP_FRAG_VERSION;
+        hdr.frame_id = id;
+        hdr.frag_index = i;
+        hdr.frag_count = count;
+        hdr.frame_len = (uint32_t)len;
+        hdr.timestamp_us = id * 1000ULL;
+        size_t off = (size_t)i * UDP_FRAG_PAYLOAD;
+        size_t n = std::min(len - off, (size_t)UDP_FRAG_PAYLOAD);
+        bytes_t pkt((const uint8_t *)&hdr, (const uint8_t *)&hdr + sizeof(hdr));
+        pkt.insert(pkt.end(), data.begin() + off, data.begin() + off + n);
+        out.push_back(pkt);
+    }
+    return out;
+}
+
+static void send_packets(const std::vector<bytes_t> &pkts) {
+    for (const bytes_t &p : pkts) {
+        sendto(tx_fd, p.data(), p.size(), 0, (sockaddr *)&rx_addr, sizeof(rx_addr));
+    }
+}
+
+static void send_frame(uint32_t id, size_t len) {
+    send_packets(fragments(id, len));
+}
+
+static bool frame_ok(const udp_jpeg::Frame &f, uint32_t id, size_t len) {
+    bytes_t want = frame_data(id, len);
+    return f.id == id && f.size == len && f.timestamp_us == id * 1000ULL &&
+           memcmp(f.data, want.data(), len) == 0;
+}
+
+static bool open_pair(udp_jpeg::Receiver *rx) {
+    if (!rx->open(0, "127.0.0.1")) {
+        return false;
+    }
+    socklen_t alen = sizeof(rx_addr);
+    getsockname(rx->fd(), (sockaddr *)&rx_addr, &alen);
+    return true;
+}
+
+// 순서대로 온 프레임
+static void test_in_order() {
+    udp_jpeg::Receiver rx;
+    CHECK(open_pair(&rx));
+    udp_jpeg::Frame f = {};
+    for (uint32_t id = 1; id <= 5; id++) {
+        send_frame(id, 3000 + id * 500);
+        CHECK(rx.receive(&f, 500));
+        CHECK(frame_ok(f, id, 3000 + id * 500));
+    }
+    CHECK_EQ(rx.stats().frames, 5);
+    CHECK_EQ(rx.stats().incomplete, 0);
+}
+
+// 두 프레임의 조각이 섞여 오고, 세 번째 프레임은 조각 하나가 빠진다
+static void test_shuffled_and_dropped() {
+    udp_jpeg::Receiver rx;
+    CHECK(open_pair(&rx));
+    std::mt19937 rng(1);
+    std::vector<bytes_t> pkts = fragments(10, 9000);
+    std::vector<bytes_t> b = fragments(11, 7000);
+    pkts.insert(pkts.end(), b.begin(), b.end());
+    std::shuffle(pkts.begin(), pkts.end(), rng);
+    send_packets(pkts);
+
+    udp_jpeg::Frame f = {};
+    CHECK(rx.receive(&f, 500));
+    uint32_t first = f.id;
+    CHECK(frame_ok(f, first, first == 10 ? 9000 : 7000));
+    if (first == 10) {  // 10 이 먼저 끝나면 11 도 이어서 끝난다
+        CHECK(rx.receive(&f, 500));
+        CHECK(frame_ok(f, 11, 7000));
+    }
+
+    std::vector<bytes_t> lossy = fragments(12, 8000);
+    lossy.erase(lossy.begin() + 2);
+    std::shuffle(lossy.begin(), lossy.end(), rng);
+    send_packets(lossy);
+    CHECK(!rx.receive(&f, 100));
+    send_frame(13, 4000);
+    CHECK(rx.receive(&f, 500));
+    CHECK(frame_ok(f, 13, 4000));
+    CHECK_EQ(rx.stats().incomplete, first == 10 ? 1 : 2);  // 12, (10 보다 11 이 먼저 끝났으면 10 도)
+}
+
+// 이미 넘긴 프레임의 조각은 버린다
+static void test_late_fragment() {
+    udp_jpeg::Receiver rx;
+    CHECK(open_pair(&rx));
+    udp_jpeg::Frame f = {};
+    send_frame(20, 3000);
+    send_frame(21, 3000);
+    CHECK(rx.receive(&f, 500));
+    CHECK(rx.receive(&f, 500));
+    CHECK_EQ(f.id, 21);
+    send_packets(fragments(20, 3000));
+    CHECK(!rx.receive(&f, 100));
+    CHECK_EQ(rx.stats().late_packets, 3);
+    CHECK_EQ(rx.stats().resyncs, 0);
+}
+
+// 차가 다시 켜져서 번호가 크게 뒤로 간다 -> 바로 새 스트림으로 받는다
+static void test_reboot_far() {
+    udp_jpeg::Receiver rx;
+    CHECK(open_pair(&rx));
+    udp_jpeg::Frame f = {};
+    send_frame(5000, 3000);
+    CHECK(rx.receive(&f, 500));
+    for (uint32_t id = 1; id <= 3; id++) {
+        send_frame(id, 2500);
+        CHECK(rx.receive(&f, 500));
+        CHECK(frame_ok(f, id, 2500));
+    }
+    CHECK_EQ(rx.stats().resyncs, 1);
+}
+
+// 번호가 조금만 뒤로 가면 (빨리 다시 켜짐) resync_ms 동안 프레임이 없을 때 새 스트림으로 받는다
+static void test_reboot_near() {
+    udp_jpeg::Receiver rx(4, 64 * 1024, 50);
+    CHECK(open_pair(&rx));
+    udp_jpeg::Frame f = {};
+    send_frame(30, 3000);
+    CHECK(rx.receive(&f, 500));
+    send_frame(2, 3000);
+    CHECK(!rx.receive(&f, 20));  // 아직은 늦게 온 조각으로 본다
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    send_frame(3, 3000);
+    CHECK(rx.receive(&f, 500));
+    CHECK(frame_ok(f, 3, 3000));
+    send_frame(4, 3000);
+    CHECK(rx.receive(&f, 500));
+    CHECK(frame_ok(f, 4, 3000));
+    CHECK_EQ(rx.stats().resyncs, 1);
+}
+
+// 같은 번호의 조각이 다른 길이를 주장하면 버린다 (슬롯 밖에 쓰면 안 된다)
+static void test_mismatched_length() {
+    udp_jpeg::Receiver rx(4, 10000);  // 1400 의 배수가 아니다
+    CHECK(open_pair(&rx));
+    udp_jpeg::Frame f = {};
+    std::vector<bytes_t> small = fragments(40, 2000);  // 조각 2 개
+    std::vector<bytes_t> big = fragments(40, 10000);   // 조각 8 개, 마지막 조각이 버퍼 끝까지
+    send_packets({ small[0], big[7], big[3], small[1] });
+    CHECK(rx.receive(&f, 500));
+    CHECK(frame_ok(f, 40, 2000));
+    CHECK_EQ(rx.stats().bad_packets, 2);
+
+    // 반대로 큰 길이로 시작한 슬롯에 작은 길이의 조각이 와도 섞이지 않는다
+    small = fragments(41, 2000);
+    big = fragments(41, 9000);
+    send_packets({ big[0], small[1], small[0] });
+    CHECK(!rx.receive(&f, 100));
+    CHECK_EQ(rx.stats().bad_packets, 4);
+    send_packets(std::vector<bytes_t>(big.begin() + 1, big.end()));
+    CHECK(rx.receive(&f, 500));
+    CHECK(frame_ok(f, 41, 9000));
+}
+
+// 프레임 번호가 2^32 에서 넘어가도 이어진다
+static void test_wraparound() {
+    udp_jpeg::Receiver rx;
+    CHECK(open_pair(&rx));
+    udp_jpeg::Frame f = {};
+    for (uint32_t id = 0xFFFFFFFEu, i = 0; i < 4; id++, i++) {
+        send_frame(id, 2000);
+        CHECK(rx.receive(&f, 500));
+        CHECK_EQ(f.id, id);
+    }
+    CHECK_EQ(rx.stats().resyncs, 0);
+}
+
+int main() {
+    tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    test_in_order();
+    test_shuffled_and_dropped();
+    test_late_fragment();
+    test_reboot_far();
+    test_reboot_near();
+    test_mismatched_length();
+    test_wraparound();
+    close(tx_fd);
+    return check_report("udp_receiver");
+}
@@ -0,0 +1,162 @@
+// ws_rx.h : 제어 WebSocket 이 세션 버퍼 하나에 메시지를 받아 그 자리에서 파싱하는지,
+// 메시지마다 힙을 쓰지 않는지, 너무 긴 프레임은 페이로드를 읽기 전에 거절하는지 시험한다.
+
+#include "alloc_count.h"
+
+#include <string>
+#include <vector>
+
+#include "../../control_proto.h"
+#include "../../ws_rx.h"
+#include "check.h"
+
+static void stub_rx(const void *data, size_t len, httpd_ws_type_t type) {
+    stub_ws_rx_data = (const uint8_t *)data;
+    stub_ws_rx_len = len;
+    stub_ws_rx_type = type;
+}
+
+static void ctrl_wire(uint8_t *out, uint32_t seq, int16_t angle, int16_t speed) {
+    ctrl_msg_t msg = {};
+    msg.version = CTRL_PROTO_VERSION;
+    msg.opcode = CTRL_OP_MOVE;
+    msg.seq = seq;
+    msg.angle = angle;
+    msg.speed = speed;
+    memcpy(out, &msg, sizeof(msg));
+}
+
+// 핸드셰이크 없이 열린 세션: 첫 메시지에서 한 번 잡고 그 뒤로는 같은 버퍼를 쓴다
+static void test_session_reuse() {
+    const int N = 500;
+    // 메시지는 미리 만들어둔다 (세는 구간에서 문자열을 만들면 그게 힙을 쓴다)
+    std::vector<std::string> texts;
+    std::vector<std::vector<uint8_t>> bins;
+    for (int i = 0; i < N; i++) {
+        char json[64];
+        snprintf(json, sizeof(json), "{\"angle\":%d,\"speed\":%d}", i % 91 - 45, i % 256);
+        texts.push_back(json);
+        bins.push_back(std::vector<uint8_t>(sizeof(ctrl_msg_t)));
+        ctrl_wire(bins.back().data(), i + 1, (int16_t)(i % 91 - 45), (int16_t)(i % 256));
+    }
+
+    ws_rx_stats = {};
+    httpd_req_t req = {};
+    httpd_ws_frame_t pkt;
+    stub_ws_rx_reads = 0;
+
+    stub_rx("{\"cmd\":\"stop\"}", 14, HTTPD_WS_TYPE_TEXT);
+    CHECK_EQ(ws_rx_recv(&req, &pkt), ESP_OK);
+    CHECK_EQ(ws_rx_stats.rx_allocs, 1);
+    CHECK(req.sess_ctx != NULL && req.free_ctx == block_free);
+    CHECK(pkt.payload == req.sess_ctx);
+    CHECK(strcmp((const char *)pkt.payload, "{\"cmd\":\"stop\"}") == 0);
+    uint8_t *session_buf = (uint8_t *)req.sess_ctx;
+
+    int text_ok = 0, bin_ok = 0, same_buf = 0;
+    alloc_count_begin();
+    for (int i = 0; i < N; i++) {
+        stub_rx(texts[i].data(), texts[i].size(), HTTPD_WS_TYPE_TEXT);
+        if (ws_rx_recv(&req, &pkt) == ESP_OK && pkt.type == HTTPD_WS_TYPE_TEXT &&
+            pkt.len == texts[i].size() && memcmp(pkt.payload, texts[i].data(), pkt.len) == 0 &&
+            pkt.payload[pkt.len] == '\0') {
+            text_ok++;
+        }
+        same_buf += pkt.payload == session_buf;
+
+        // 바이너리 제어 메시지는 받은 버퍼에서 바로 해석한다
+        stub_rx(bins[i].data(), bins[i].size(), HTTPD_WS_TYPE_BINARY);
+        ctrl_msg_t msg;
+        if (ws_rx_recv(&req, &pkt) == ESP_OK && pkt.type == HTTPD_WS_TYPE_BINARY &&
+            ctrl_parse(pkt.payload, pkt.len, &msg) && msg.seq == (uint32_t)i + 1 &&
+            msg.angle == i % 91 - 45 && msg.speed == i % 256) {
+            bin_ok++;
+        }
+        same_buf += pkt.payload == session_buf;
+    }
+    long heap_ops = alloc_count_end();
+
+    CHECK_EQ(text_ok, N);
+    CHECK_EQ(bin_ok, N);
+    CHECK_EQ(same_buf, 2 * N);
+    CHECK_EQ(heap_ops, 0);
+    CHECK_EQ(ws_rx_stats.rx_allocs, 1);
+    CHECK_EQ(ws_rx_stats.messages, 2 * N + 1);
+    CHECK_EQ(stub_ws_rx_reads, 2 * N + 1);
+    CHECK(req.sess_ctx == session_buf);
+    printf("  %d messages on one session: %u buffer allocations, %ld heap operations\n",
+           2 * N + 1, (unsigned)ws_rx_stats.rx_allocs, heap_ops);
+
+    // 연결이 닫히면 httpd 가 free_ctx 로 버퍼를 풀어준다
+    int used = block_pools[0].used;
+    req.free_ctx(req.sess_ctx);
+    CHECK_EQ(block_pools[0].used, used - 1);
+}
+
+// 핸드셰이크에서 붙인 버퍼는 첫 메시지에서도 다시 잡지 않는다
+static void test_open() {
+    ws_rx_stats = {};
+    httpd_req_t req = {};
+    ws_rx_open(&req);
+    CHECK_EQ(ws_rx_stats.rx_allocs, 1);
+    void *buf = req.sess_ctx;
+    CHECK(buf != NULL);
+
+    httpd_ws_frame_t pkt;
+    alloc_count_begin();
+    stub_rx("{\"led\":1}", 9, HTTPD_WS_TYPE_TEXT);
+    esp_err_t ret = ws_rx_recv(&req, &pkt);
+    long heap_ops = alloc_count_end();
+    CHECK_EQ(ret, ESP_OK);
+    CHECK_EQ(heap_ops, 0);
+    CHECK(pkt.payload == buf);
+    CHECK_EQ(ws_rx_stats.rx_allocs, 1);
+    req.free_ctx(req.sess_ctx);
+}
+
+// 길이 제한: WS_RX_MAX_LEN 까지는 받고, 넘으면 페이로드를 읽지 않고 거절한다
+static void test_oversize() {
+    ws_rx_stats = {};
+    httpd_req_t req = {};
+    ws_rx_open(&req);
+    httpd_ws_frame_t pkt;
+    std::string big(WS_RX_MAX_LEN + 1, 'x');
+
+    stub_ws_rx_reads = 0;
+    stub_rx(big.data(), WS_RX_MAX_LEN, HTTPD_WS_TYPE_TEXT);
+    CHECK_EQ(ws_rx_recv(&req, &pkt), ESP_OK);
+    CHECK_EQ(pkt.len, WS_RX_MAX_LEN);
+    CHECK_EQ(pkt.payload[WS_RX_MAX_LEN], '\0');
+    CHECK_EQ(stub_ws_rx_reads, 1);
+
+    stub_rx("ok", 2, HTTPD_WS_TYPE_TEXT);
+    CHECK_EQ(ws_rx_recv(&req, &pkt), ESP_OK);
+
+    stub_rx(big.data(), big.size(), HTTPD_WS_TYPE_TEXT);
+    CHECK_EQ(ws_rx_recv(&req, &pkt), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(stub_ws_rx_reads, 2);  // 길이만 보고 거절
+    CHECK(pkt.payload == NULL);
+    CHECK(strcmp((const char *)req.sess_ctx, "ok") == 0);  // 버퍼는 그대로
+    CHECK_EQ(ws_rx_stats.oversize, 1);
+    CHECK_EQ(ws_rx_stats.messages, 2);
+
+    // 빈 프레임은 읽지 않고 len 0 으로 돌려준다
+    stub_rx("", 0, HTTPD_WS_TYPE_TEXT);
+    CHECK_EQ(ws_rx_recv(&req, &pkt), ESP_OK);
+    CHECK_EQ(pkt.len, 0);
+    CHECK_EQ(stub_ws_rx_reads, 2);
+
+    char json[128];
+    CHECK(ws_rx_json(json, sizeof(json)) > 0);
+    CHECK(strstr(json, "\"oversize\":1") != NULL);
+    req.free_ctx(req.sess_ctx);
+}
+
+int main() {
+    log_init();
+    block_pool_init();
+    test_session_reuse();
+    test_open();
+    test_oversize();
+    return check_report("ws_rx");
+}
@@ -0,0 +1,30 @@
+#ifndef UDP_FRAME_PROTO_H
+#define UDP_FRAME_PROTO_H
+
+#include <stdint.h>
+
+// UDP JPEG 조각 스트림의 전송 형식. 차 (stream_sender.h) 와
+// PC 수신 라이브러리 (pc/udp_jpeg_receiver.h) 가 같이 쓴다.
+//
+// JPEG 하나를 UDP_FRAG_PAYLOAD 바이트씩 잘라 데이터그램 하나에 하나씩 보낸다.
+// 각 데이터그램 = udp_frag_hdr_t (24 바이트, little endian) + 조각 데이터.
+// 조각 i 의 데이터는 프레임의 i * UDP_FRAG_PAYLOAD 위치에 들어간다.
+// 수신 측은 조각이 빠진 프레임을 기다리지 않고 버린다.
+
+#define UDP_FRAG_MAGIC 0x4A55     // "UJ"
+#define UDP_FRAG_VERSION 1
+#define UDP_FRAG_DATAGRAM 1400    // IP 조각화가 생기지 않도록 MTU 보다 작게
+#define UDP_FRAG_PAYLOAD (UDP_FRAG_DATAGRAM - (int)sizeof(udp_frag_hdr_t))
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;          // UDP_FRAG_MAGIC
+    uint8_t version;         // UDP_FRAG_VERSION
+    uint8_t flags;           // 예약 (0)
+    uint32_t frame_id;       // 프레임 번호 (X-Frame-Seq 와 같음)
+    uint16_t frag_index;     // 0 부터
+    uint16_t frag_count;     // 이 프레임의 조각 수
+    uint32_t frame_len;      // JPEG 전체 길이
+    uint64_t timestamp_us;   // 캡처 시각 (차의 esp_timer 기준)
+} udp_frag_hdr_t;
+
+#endif  // UDP_FRAME_PROTO_H
@@ -0,0 +1,78 @@
+#ifndef VIDEO_WS_H
+#define VIDEO_WS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_http_server.h>
+
+#include "stream_sender.h"
+#include "log_ring.h"
+
+// WebSocket 비디오 핸들러 (/video_ws)
+// 연결되면 JPEG 마다 바이너리 프레임 하나를 보낸다:
+//   [seq u32][timestamp_us u64][size u32] (little endian, 16 바이트) + JPEG
+// 클라이언트는 {"credit": N} 을 보내 N 프레임을 더 받을 수 있다고 알린다.
+// 크레딧이 없으면 차는 보내지 않고, 그 사이 프레임은 건너뛴다.
+// 제어 프레임도 이 핸들러가 받는다 (handle_ws_control_frames). 소켓은 전송 태스크가 쓰고 있으므로
+// PING 의 PONG 은 전송 태스크가 프레임 사이에 보낸다. CLOSE 를 받으면 연결을 닫고, PONG 은 무시한다.
+esp_err_t video_ws_handler(httpd_req_t *req) {
+  if (req->method == HTTP_GET) {
+    // 핸드셰이크가 끝났으므로 스트림 세션을 전송 태스크에 넘긴다
+    return stream_session_start(req, "video_ws", STREAM_WEBSOCKET);
+  }
+
+  httpd_ws_frame_t ws_pkt;
+  memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+
+  // 프레임 길이 수신
+  esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+
+  if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
+    return ESP_FAIL;  // 서버가 세션을 닫고 close_fn 이 전송 태스크를 멈춘다
+  }
+  if (ws_pkt.type == HTTPD_WS_TYPE_PING || ws_pkt.type == HTTPD_WS_TYPE_PONG) {
+    uint8_t ctrl[STREAM_WS_CONTROL_MAX];
+    if (ws_pkt.len > sizeof(ctrl)) {
+      return ESP_FAIL;  // 제어 프레임은 125 바이트를 넘을 수 없다
+    }
+    ws_pkt.payload = ctrl;
+    if (ws_pkt.len && (ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len)) != ESP_OK) {
+      return ret;
+    }
+    if (ws_pkt.type == HTTPD_WS_TYPE_PING) {
+      stream_ws_ping(req->handle, httpd_req_to_sockfd(req), ctrl, ws_pkt.len);
+    }
+    return ESP_OK;  // PONG 은 페이로드만 읽고 버린다
+  }
+
+  // 크레딧 메시지는 짧으므로 스택 버퍼로 받는다
+  char buf[64];
+  if (ws_pkt.len == 0 || ws_pkt.len >= sizeof(buf)) {
+    LOG_W("video_ws: ignoring %d byte message", (int)ws_pkt.len);
+    return ws_pkt.len == 0 ? ESP_OK : ESP_FAIL;
+  }
+  ws_pkt.payload = (uint8_t *)buf;
+  ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  buf[ws_pkt.len] = '\0';
+
+  StaticJsonDocument<64> jsonDoc;
+  DeserializationError error = deserializeJson(jsonDoc, buf);
+  if (error) {
+    LOG_W("video_ws JSON parse error: %s", error.c_str());
+    return ESP_OK;
+  }
+
+  int credit = jsonDoc["credit"] | 0;
+  if (credit > 0) {
+    stream_ws_credit(req->handle, httpd_req_to_sockfd(req), credit);
+  }
+  return ESP_OK;
+}
+
+#endif  // VIDEO_WS_H
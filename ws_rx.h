@@ -0,0 +1,94 @@
+#ifndef WS_RX_H
+#define WS_RX_H
+
+#include "Arduino.h"
+#include "esp_http_server.h"
+#include "block_pool.h"
+#include "stream_stats.h"
+#include "log_ring.h"
+
+// 제어 WebSocket (/ws, /alt_ws) 수신 버퍼. 조향 명령마다 버퍼를 잡고 놓지 않도록
+// 연결을 열 때 (핸드셰이크) 세션마다 WS_RX_MAX_LEN + 1 바이트 버퍼를 하나 붙여두고
+// 연결이 닫히면 httpd 가 풀어준다 (sess_ctx / free_ctx). 메시지는 그 버퍼에 받아 그 자리에서 파싱한다.
+// WS_RX_MAX_LEN 보다 긴 프레임은 버퍼를 건드리기 전에 거절한다 (연결이 닫힌다).
+//
+// rx_allocs 는 수신 경로가 버퍼를 잡은 횟수이므로 연결 수만큼만 늘어야 한다.
+// messages 가 늘어도 rx_allocs 가 그대로면 메시지당 힙 연산은 0 이다.
+
+#define WS_RX_MAX_LEN (POOL_SMALL_SIZE - 1)  // JSON (StaticJsonDocument<256>) 과 바이너리 제어 메시지의 최대 길이
+
+typedef struct {
+    uint32_t messages;   // 받은 메시지 수
+    uint32_t oversize;   // 너무 길어서 거절한 프레임 수
+    uint32_t rx_allocs;  // 수신 버퍼를 잡은 횟수 (연결당 한 번)
+} ws_rx_stats_t;
+
+static ws_rx_stats_t ws_rx_stats;
+
+// 세션 버퍼를 돌려준다. 없으면 (핸드셰이크에서 못 잡았으면) 지금 잡는다.
+static uint8_t *ws_rx_buffer(httpd_req_t *req) {
+    if (!req->sess_ctx) {
+        req->sess_ctx = block_alloc(WS_RX_MAX_LEN + 1);
+        req->free_ctx = block_free;
+        if (req->sess_ctx) {
+            __atomic_add_fetch(&ws_rx_stats.rx_allocs, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return (uint8_t *)req->sess_ctx;
+}
+
+// 핸드셰이크 (HTTP_GET) 에서 호출해 세션 버퍼를 붙인다
+void ws_rx_open(httpd_req_t *req) {
+    if (!ws_rx_buffer(req)) {
+        LOG_E("Failed to allocate WebSocket receive buffer");
+    }
+}
+
+// 프레임 하나를 세션 버퍼에 받는다. payload 는 NUL 로 끝난다.
+// 길이가 0 인 프레임이면 ESP_OK 에 pkt->len == 0.
+esp_err_t ws_rx_recv(httpd_req_t *req, httpd_ws_frame_t *pkt) {
+    memset(pkt, 0, sizeof(httpd_ws_frame_t));
+    pkt->type = HTTPD_WS_TYPE_TEXT;
+
+    // 프레임 길이 수신
+    esp_err_t ret = httpd_ws_recv_frame(req, pkt, 0);
+    if (ret != ESP_OK) {
+        LOG_W("Failed to receive frame length: %d", ret);
+        return ret;
+    }
+    if (pkt->len == 0) {
+        return ESP_OK;
+    }
+    if (pkt->len > WS_RX_MAX_LEN) {
+        __atomic_add_fetch(&ws_rx_stats.oversize, 1, __ATOMIC_RELAXED);
+        LOG_W("WebSocket frame too large: %u", (unsigned)pkt->len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t *buf = ws_rx_buffer(req);
+    if (!buf) {
+        LOG_E("Failed to allocate memory for WebSocket payload");
+        return ESP_ERR_NO_MEM;
+    }
+    pkt->payload = buf;
+
+    // 실제 페이로드 수신
+    ret = httpd_ws_recv_frame(req, pkt, pkt->len);
+    if (ret != ESP_OK) {
+        LOG_W("Failed to receive frame payload: %d", ret);
+        return ret;
+    }
+    buf[pkt->len] = '\0';  // Null-terminate the payload
+    __atomic_add_fetch(&ws_rx_stats.messages, 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+// /stats 용 JSON
+int ws_rx_json(char *buf, size_t len) {
+    int n = snprintf(buf, len, "{\"messages\":%u,\"oversize\":%u,\"rx_allocs\":%u,\"max_len\":%d}",
+                     (unsigned)ws_rx_stats.messages, (unsigned)ws_rx_stats.oversize,
+                     (unsigned)ws_rx_stats.rx_allocs, WS_RX_MAX_LEN);
+    return stats_json_fit(n, len);
+}
+
+#endif  // WS_RX_H